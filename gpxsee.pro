@@ -120,6 +120,7 @@ HEADERS += src/common/config.h \
     src/data/style.h \
     src/data/twonavparser.h \
     src/map/ENC/attributes.h \
+    src/map/ENC/atlasdata.h \
     src/map/ENC/mapdata.h \
     src/map/ENC/objects.h \
     src/map/ENC/rastertile.h \
@@ -128,6 +129,7 @@ HEADERS += src/common/config.h \
     src/map/IMG/zoom.h \
     src/map/conversion.h \
     src/map/encmap.h \
+    src/map/encatlas.h \
     src/map/ENC/iso8211.h \
     src/map/gemfmap.h \
     src/map/oruxmap.h \
@@ -215,14 +217,20 @@ HEADERS += src/common/config.h \
     src/map/geocentric.h \
     src/map/jnxmap.h \
     src/map/geotiffmap.h \
+    src/map/tiffimage.h \
     src/map/image.h \
     src/map/mbtilesmap.h \
     src/map/osm.h \
     src/map/rmap.h \
     src/map/calibrationpoint.h \
     src/map/textitem.h \
+    src/map/textitemgrid.h \
     src/map/aqmmap.h \
     src/map/mapsforgemap.h \
+    src/map/diskcache.h \
+    src/map/tilescheduler.h \
+    src/map/cachebudget.h \
+    src/map/shardedcache.h \
     src/map/worldfilemap.h \
     src/map/imgmap.h \
     src/data/itnparser.h \
@@ -236,6 +244,7 @@ HEADERS += src/common/config.h \
     src/data/route.h \
     src/data/trackpoint.h \
     src/data/data.h \
+    src/data/dataloader.h \
     src/data/parser.h \
     src/data/trackdata.h \
     src/data/routedata.h \
@@ -334,11 +343,13 @@ SOURCES += src/main.cpp \
     src/GUI/projectioncombobox.cpp \
     src/GUI/passwordedit.cpp \
     src/data/twonavparser.cpp \
+    src/map/ENC/atlasdata.cpp \
     src/map/ENC/mapdata.cpp \
     src/map/ENC/rastertile.cpp \
     src/map/ENC/style.cpp \
     src/map/conversion.cpp \
     src/map/encmap.cpp \
+    src/map/encatlas.cpp \
     src/map/ENC/iso8211.cpp \
     src/map/gemfmap.cpp \
     src/map/oruxmap.cpp \
@@ -417,14 +428,19 @@ SOURCES += src/main.cpp \
     src/map/jnxmap.cpp \
     src/map/map.cpp \
     src/map/geotiffmap.cpp \
+    src/map/tiffimage.cpp \
     src/map/image.cpp \
     src/map/mbtilesmap.cpp \
     src/map/osm.cpp \
     src/map/rectd.cpp \
     src/map/rmap.cpp \
     src/map/textitem.cpp \
+    src/map/textitemgrid.cpp \
     src/map/aqmmap.cpp \
     src/map/mapsforgemap.cpp \
+    src/map/diskcache.cpp \
+    src/map/tilescheduler.cpp \
+    src/map/cachebudget.cpp \
     src/map/worldfilemap.cpp \
     src/data/address.cpp \
     src/data/itnparser.cpp \
@@ -432,6 +448,7 @@ SOURCES += src/main.cpp \
     src/data/ov2parser.cpp \
     src/data/waypoint.cpp \
     src/data/data.cpp \
+    src/data/dataloader.cpp \
     src/data/poi.cpp \
     src/data/track.cpp \
     src/data/route.cpp \
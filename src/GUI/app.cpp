@@ -8,6 +8,7 @@
 #include <QSurfaceFormat>
 #include <QImageReader>
 #include <QFileInfo>
+#include <QDir>
 #ifdef Q_OS_ANDROID
 #include <QCoreApplication>
 #include <QJniObject>
@@ -19,6 +20,8 @@
 #include "map/gcs.h"
 #include "map/conversion.h"
 #include "map/pcs.h"
+#include "map/maplist.h"
+#include "data/data.h"
 #include "data/dem.h"
 #include "data/waypoint.h"
 #include "gui.h"
@@ -26,6 +29,27 @@
 #include "app.h"
 
 
+static bool isDataFile(const QFileInfo &fi)
+{
+	/* Files that may also be maps (e.g. KMZ) are not data files here, they
+	   have to go the "data or map" path */
+	QString suffix("*." + fi.suffix().toLower());
+	return (Data::filter().contains(suffix)
+	  && !MapList::filter().contains(suffix));
+}
+
+static QStringList dataFiles(const QString &path)
+{
+	QFileInfoList fl(QDir(path).entryInfoList(QDir::Files, QDir::Name));
+	QStringList files;
+
+	for (int i = 0; i < fl.size(); i++)
+		if (isDataFile(fl.at(i)))
+			files.append(fl.at(i).absoluteFilePath());
+
+	return files;
+}
+
 App::App(int &argc, char **argv) : QApplication(argc, argv)
 {
 #if defined(Q_OS_WIN32) || defined(Q_OS_MAC)
@@ -86,10 +110,31 @@ int App::run()
 {
 	MapAction *lastReady = 0;
 	QStringList args(arguments());
+	QStringList files;
 
 	_gui->show();
 
+	/* The data files (including the data files of directories) are loaded
+	   asynchronously all at once, maps and ambiguous files are processed
+	   one by one */
 	for (int i = 1; i < args.count(); i++) {
+		QFileInfo fi(args.at(i));
+
+		if (fi.isDir()) {
+			QStringList dir(dataFiles(args.at(i)));
+			if (!dir.isEmpty()) {
+				/* The directory may be a map directory as well */
+				MapAction *a;
+				if (_gui->loadMap(args.at(i), a, true) && a)
+					lastReady = a;
+				files.append(dir);
+				continue;
+			}
+		} else if (isDataFile(fi)) {
+			files.append(args.at(i));
+			continue;
+		}
+
 		if (!_gui->openFile(args.at(i), true)) {
 			MapAction *a;
 			if (!_gui->loadMap(args.at(i), a, true))
@@ -104,6 +149,8 @@ int App::run()
 	if (lastReady)
 		lastReady->trigger();
 
+	_gui->openFiles(files);
+
 	return exec();
 }
 
@@ -26,15 +26,19 @@
 #include <QStyle>
 #include <QTabBar>
 #include <QGeoPositionInfoSource>
+#include <QProgressDialog>
 #include "common/config.h"
 #include "common/programpaths.h"
 #include "common/downloader.h"
 #include "data/data.h"
 #include "data/poi.h"
 #include "data/demloader.h"
+#include "data/dataloader.h"
 #include "map/maplist.h"
 #include "map/emptymap.h"
 #include "map/crs.h"
+#include "map/cachebudget.h"
+#include "map/image.h"
 #include "icons.h"
 #include "keys.h"
 #include "settings.h"
@@ -68,6 +72,10 @@ GUI::GUI()
 	_poi = new POI(this);
 	_dem = new DEMLoader(ProgramPaths::demDir(true), this);
 	connect(_dem, &DEMLoader::finished, this, &GUI::demLoaded);
+	_dataLoader = new DataLoader(this);
+	connect(_dataLoader, &DataLoader::loaded, this, &GUI::dataLoaded);
+	connect(_dataLoader, &DataLoader::finished, this,
+	  &GUI::dataLoadingFinished);
 
 	createMapView();
 	createGraphTabs();
@@ -948,8 +956,7 @@ void GUI::openFile()
 	  _dataDir, Data::formats()));
 #endif // Q_OS_ANDROID
 
-	for (int i = 0; i < files.size(); i++)
-		openFile(files.at(i));
+	openFiles(files);
 	if (!files.isEmpty())
 		_dataDir = QFileInfo(files.last()).path();
 }
@@ -991,6 +998,87 @@ bool GUI::openFile(const QString &fileName, bool silent)
 	return true;
 }
 
+void GUI::openFiles(const QStringList &files)
+{
+	QStringList list;
+
+	for (int i = 0; i < files.size(); i++)
+		if (!_files.contains(files.at(i)) && !list.contains(files.at(i)))
+			list.append(files.at(i));
+
+	if (list.size() == 1)
+		openFile(list.first());
+	else if (list.size() > 1)
+		loadFiles(list);
+}
+
+void GUI::loadFiles(const QStringList &files)
+{
+	/* Files opened while another load is running are appended to it, the
+	   running load's progress dialog and error report cover them */
+	if (_dataLoader->isRunning()) {
+		_dataLoader->load(files);
+		return;
+	}
+
+	QProgressDialog *progress = new QProgressDialog(tr("Loading files..."),
+	  tr("Cancel"), 0, files.size(), this);
+	progress->setWindowModality(Qt::WindowModal);
+	progress->setMinimumDuration(500);
+	progress->setValue(0);
+	connect(progress, &QProgressDialog::canceled, _dataLoader,
+	  &DataLoader::cancel);
+	connect(_dataLoader, &DataLoader::progress, progress,
+	  &QProgressDialog::setValue);
+	connect(_dataLoader, &DataLoader::queued, progress,
+	  &QProgressDialog::setMaximum);
+	connect(_dataLoader, &DataLoader::finished, progress,
+	  &QObject::deleteLater);
+
+	_loadErrors.clear();
+	_dataLoader->load(files);
+}
+
+void GUI::dataLoaded(const QString &fileName, const Data &data)
+{
+	if (data.isValid()) {
+		loadData(data);
+		_files.append(fileName);
+	} else {
+		QString error(Util::displayName(fileName) + ": " + data.errorString());
+		if (data.errorLine())
+			error.append(" (" + tr("Line: %1").arg(data.errorLine()) + ")");
+		_loadErrors.append(error);
+	}
+}
+
+void GUI::dataLoadingFinished()
+{
+	if (_files.isEmpty())
+		_fileActionGroup->setEnabled(false);
+	else {
+#ifndef Q_OS_ANDROID
+		_browser->setCurrent(_files.last());
+#endif // Q_OS_ANDROID
+		_fileActionGroup->setEnabled(true);
+		_reloadFileAction->setEnabled(true);
+		_navigationActionGroup->setEnabled(true);
+	}
+
+	updateNavigationActions();
+	updateStatusBarInfo();
+	updateWindowTitle();
+	updateGraphTabs();
+	updateDEMDownloadAction();
+
+	if (!_loadErrors.isEmpty()) {
+		QString error = tr("Error loading data file:") + "\n\n"
+		  + _loadErrors.join("\n");
+		_loadErrors.clear();
+		QMessageBox::critical(this, APP_NAME, error);
+	}
+}
+
 bool GUI::loadFile(const QString &fileName, bool silent)
 {
 	Data data(fileName, !silent);
@@ -1466,6 +1554,13 @@ void GUI::reloadFiles()
 		_tabs.at(i)->clear();
 	_mapView->clear();
 
+	if (_files.size() > 1) {
+		QStringList files(_files);
+		_files.clear();
+		loadFiles(files);
+		return;
+	}
+
 	for (int i = 0; i < _files.size(); i++) {
 		if (!loadFile(_files.at(i))) {
 			_files.removeAt(i);
@@ -1486,6 +1581,8 @@ void GUI::reloadFiles()
 
 void GUI::closeFiles()
 {
+	_dataLoader->cancel();
+
 	_trackCount = 0;
 	_routeCount = 0;
 	_waypointCount = 0;
@@ -2412,6 +2509,9 @@ void GUI::writeSettings()
 	WRITE(enableHTTP2, _options.enableHTTP2);
 	WRITE(pixmapCache, _options.pixmapCache);
 	WRITE(demCache, _options.demCache);
+	WRITE(mapDataCache, _options.mapDataCache);
+	WRITE(imagePyramid, _options.imagePyramid);
+	WRITE(tilePrefetch, _options.tilePrefetch);
 	WRITE(connectionTimeout, _options.connectionTimeout);
 	WRITE(hiresPrint, _options.hiresPrint);
 	WRITE(printName, _options.printName);
@@ -2694,6 +2794,9 @@ void GUI::readSettings(QString &activeMap, QStringList &disabledPOIs)
 	_options.enableHTTP2 = READ(enableHTTP2).toBool();
 	_options.pixmapCache = READ(pixmapCache).toInt();
 	_options.demCache = READ(demCache).toInt();
+	_options.mapDataCache = READ(mapDataCache).toInt();
+	_options.imagePyramid = READ(imagePyramid).toBool();
+	_options.tilePrefetch = READ(tilePrefetch).toInt();
 	_options.connectionTimeout = READ(connectionTimeout).toInt();
 	_options.hiresPrint = READ(hiresPrint).toBool();
 	_options.printName = READ(printName).toBool();
@@ -2740,6 +2843,7 @@ void GUI::loadOptions()
 	_mapView->setRenderHint(QPainter::Antialiasing, _options.pathAntiAliasing);
 	_mapView->setMarkerColor(_options.sliderColor);
 	_mapView->useOpenGL(_options.useOpenGL);
+	_mapView->setTilePrefetch(_options.tilePrefetch);
 	_mapView->setMapConfig(CRS::projection(_options.inputProjection),
 	  CRS::projection(4326, _options.outputProjection), _options.hidpiMap);
 	_mapView->setTimeZone(_options.timeZone.zone());
@@ -2779,6 +2883,8 @@ void GUI::loadOptions()
 
 	QPixmapCache::setCacheLimit(_options.pixmapCache * 1024);
 	DEM::setCacheSize(_options.demCache * 1024);
+	CacheBudget::setSize(_options.mapDataCache * 1024);
+	Image::usePyramid(_options.imagePyramid);
 
 	_poi->setRadius(_options.poiRadius);
 
@@ -2835,6 +2941,7 @@ void GUI::updateOptions(const Options &options)
 	SET_VIEW_OPTION(poiColor, setPOIColor);
 	SET_VIEW_OPTION(pathAntiAliasing, useAntiAliasing);
 	SET_VIEW_OPTION(useOpenGL, useOpenGL);
+	SET_VIEW_OPTION(tilePrefetch, setTilePrefetch);
 	SET_VIEW_OPTION(sliderColor, setMarkerColor);
 	SET_VIEW_OPTION(crosshairColor, setCrosshairColor);
 	SET_VIEW_OPTION(infoColor, setInfoColor);
@@ -2905,6 +3012,10 @@ void GUI::updateOptions(const Options &options)
 		QPixmapCache::setCacheLimit(options.pixmapCache * 1024);
 	if (options.demCache != _options.demCache)
 		DEM::setCacheSize(options.demCache * 1024);
+	if (options.mapDataCache != _options.mapDataCache)
+		CacheBudget::setSize(options.mapDataCache * 1024);
+	if (options.imagePyramid != _options.imagePyramid)
+		Image::usePyramid(options.imagePyramid);
 
 	if (options.connectionTimeout != _options.connectionTimeout)
 		Downloader::setTimeout(options.connectionTimeout);
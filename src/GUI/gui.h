@@ -3,6 +3,7 @@
 
 #include <QMainWindow>
 #include <QString>
+#include <QStringList>
 #include <QList>
 #include <QDate>
 #include <QPrinter>
@@ -35,6 +36,7 @@ class MapAction;
 class POIAction;
 class Data;
 class DEMLoader;
+class DataLoader;
 class NavigationWidget;
 
 class GUI : public QMainWindow
@@ -45,6 +47,7 @@ public:
 	GUI();
 
 	bool openFile(const QString &fileName, bool silent = false);
+	void openFiles(const QStringList &files);
 	bool loadMap(const QString &fileName, MapAction *&action,
 	  bool silent = false);
 	void show();
@@ -121,6 +124,8 @@ private slots:
 	void mapInitialized();
 
 	void demLoaded();
+	void dataLoaded(const QString &fileName, const Data &data);
+	void dataLoadingFinished();
 
 private:
 	typedef QPair<QDateTime, QDateTime> DateTimeRange;
@@ -153,6 +158,7 @@ private:
 	bool openPOIFile(const QString &fileName);
 	bool loadFile(const QString &fileName, bool silent = false);
 	void loadData(const Data &data);
+	void loadFiles(const QStringList &files);
 	bool loadMapNode(const TreeNode<Map*> &node, MapAction *&action,
 	  bool silent, const QList<QAction*> &existingActions);
 	void loadMapDirNode(const TreeNode<Map*> &node, QList<MapAction*> &actions,
@@ -291,6 +297,8 @@ private:
 	Map *_map;
 	QGeoPositionInfoSource *_positionSource;
 	DEMLoader *_dem;
+	DataLoader *_dataLoader;
+	QStringList _loadErrors;
 
 	FileBrowser *_browser;
 	QList<QString> _files;
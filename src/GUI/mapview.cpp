@@ -120,6 +120,8 @@ MapView::MapView(Map *map, POI *poi, QWidget *parent) : QGraphicsView(parent)
 	_showMotionInfo = false;
 
 	_opengl = false;
+	_tilePrefetch = 0;
+	_viewZoom = 0;
 	_plot = false;
 	_digitalZoom = 0;
 	_pinchZoom = 0;
@@ -406,6 +408,7 @@ void MapView::setMap(Map *map)
 	_map = map;
 	_map->load(_inputProjection, _outputProjection, _deviceRatio, _hidpi);
 	connect(_map, &Map::tilesLoaded, this, &MapView::reloadMap);
+	_viewRect = QRectF();
 
 	digitalZoom(0);
 
@@ -1105,7 +1108,28 @@ void MapView::drawBackground(QPainter *painter, const QRectF &rect)
 		else if (_opengl)
 			flags = Map::OpenGL;
 
+		/* Tiles pending for a previous view (position or zoom) that are no
+		   more visible are canceled once the view changes. The exposed rect
+		   can not be used for that, partial repaints would cancel visible
+		   tiles outside of the repainted area. */
+		bool viewChanged = false;
+		if (!_plot) {
+			QRectF vr(mapToScene(viewport()->rect()).boundingRect()
+			  .intersected(_map->bounds()));
+			if (vr != _viewRect || _map->zoom() != _viewZoom) {
+				_map->cancel(vr);
+				_viewRect = vr;
+				_viewZoom = _map->zoom();
+				viewChanged = true;
+			}
+		}
+
 		_map->draw(painter, ir, flags);
+
+		/* Prefetch the tiles surrounding the view only once per a view
+		   position/zoom */
+		if (viewChanged && _tilePrefetch)
+			_map->prefetch(_viewRect, _tilePrefetch);
 	}
 }
 
@@ -1391,6 +1415,7 @@ void MapView::setHidpi(bool hidpi)
 
 	_map->unload();
 	_map->load(_inputProjection, _outputProjection, _deviceRatio, hidpi);
+	_viewRect = QRectF();
 	rescale();
 
 	QPointF nc = QRectF(_map->ll2xy(cr.topLeft()),
@@ -94,6 +94,7 @@ public:
 	void setTimeZone(const QTimeZone &zone);
 	void setMapConfig(const Projection &in, const Projection &out, bool hidpi);
 	void setDevicePixelRatio(qreal ratio);
+	void setTilePrefetch(int tiles) {_tilePrefetch = tiles;}
 	void clearMapCache();
 	void fitContentToSize();
 
@@ -212,6 +213,10 @@ private:
 	bool _hidpi;
 	bool _opengl;
 
+	int _tilePrefetch;
+	QRectF _viewRect;
+	int _viewZoom;
+
 	int _pinchZoom;
 	int _wheelDelta;
 };
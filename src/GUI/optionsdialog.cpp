@@ -738,6 +738,28 @@ QWidget *OptionsDialog::createSystemPage()
 	_demCache->setSuffix(UNIT_SPACE + tr("MB"));
 	_demCache->setValue(_options.demCache);
 
+	_mapDataCache = new QSpinBox();
+	_mapDataCache->setMinimum(16);
+	_mapDataCache->setMaximum(1024);
+	_mapDataCache->setSuffix(UNIT_SPACE + tr("MB"));
+	_mapDataCache->setValue(_options.mapDataCache);
+
+	_imagePyramid = new QCheckBox(tr("Use image overviews"));
+	_imagePyramid->setChecked(_options.imagePyramid);
+	_imagePyramid->setToolTip(tr("Draw big image maps using reduced "
+	  "resolution overviews cached on disk when zoomed out. Applies to maps "
+	  "loaded afterwards."));
+
+	_tilePrefetch = new QSpinBox();
+	_tilePrefetch->setMinimum(0);
+	_tilePrefetch->setMaximum(256);
+	_tilePrefetch->setSpecialValueText(tr("Disabled"));
+	_tilePrefetch->setSuffix(UNIT_SPACE + tr("tiles"));
+	_tilePrefetch->setValue(_options.tilePrefetch);
+	_tilePrefetch->setToolTip(tr("Number of tiles rendered ahead around the "
+	  "view. Only applies to offline maps, online map tiles are never "
+	  "prefetched."));
+
 	_connectionTimeout = new QSpinBox();
 	_connectionTimeout->setMinimum(30);
 	_connectionTimeout->setMaximum(120);
@@ -748,7 +770,10 @@ QWidget *OptionsDialog::createSystemPage()
 	QWidget *systemTab = new QWidget();
 	QFormLayout *systemTabLayout = new QFormLayout();
 	systemTabLayout->addRow(tr("Image cache size:"), _pixmapCache);
+	systemTabLayout->addRow(tr("Map data cache size:"), _mapDataCache);
+	systemTabLayout->addRow(tr("Tile prefetch:"), _tilePrefetch);
 	systemTabLayout->addRow(tr("Connection timeout:"), _connectionTimeout);
+	systemTabLayout->addWidget(_imagePyramid);
 	systemTabLayout->addWidget(_enableHTTP2);
 	systemTabLayout->addWidget(_useOpenGL);
 	systemTab->setLayout(systemTabLayout);
@@ -756,8 +781,11 @@ QWidget *OptionsDialog::createSystemPage()
 	QFormLayout *formLayout = new QFormLayout();
 	formLayout->addRow(tr("Image cache size:"), _pixmapCache);
 	formLayout->addRow(tr("DEM cache size:"), _demCache);
+	formLayout->addRow(tr("Map data cache size:"), _mapDataCache);
+	formLayout->addRow(tr("Tile prefetch:"), _tilePrefetch);
 	formLayout->addRow(tr("Connection timeout:"), _connectionTimeout);
 	QFormLayout *checkboxLayout = new QFormLayout();
+	checkboxLayout->addWidget(_imagePyramid);
 	checkboxLayout->addWidget(_enableHTTP2);
 	checkboxLayout->addWidget(_useOpenGL);
 	QWidget *systemTab = new QWidget();
@@ -949,6 +977,9 @@ void OptionsDialog::accept()
 	_options.enableHTTP2 = _enableHTTP2->isChecked();
 	_options.pixmapCache = _pixmapCache->value();
 	_options.demCache = _demCache->value();
+	_options.mapDataCache = _mapDataCache->value();
+	_options.imagePyramid = _imagePyramid->isChecked();
+	_options.tilePrefetch = _tilePrefetch->value();
 	_options.connectionTimeout = _connectionTimeout->value();
 	_options.dataPath = _dataPath->dir();
 	_options.mapsPath = _mapsPath->dir();
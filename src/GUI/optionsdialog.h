@@ -80,6 +80,9 @@ struct Options {
 	bool enableHTTP2;
 	int pixmapCache;
 	int demCache;
+	int mapDataCache;
+	bool imagePyramid;
+	int tilePrefetch;
 	int connectionTimeout;
 	QString dataPath;
 	QString mapsPath;
@@ -184,6 +187,9 @@ private:
 	// System
 	QSpinBox *_pixmapCache;
 	QSpinBox *_demCache;
+	QSpinBox *_mapDataCache;
+	QCheckBox *_imagePyramid;
+	QSpinBox *_tilePrefetch;
 	QSpinBox *_connectionTimeout;
 	QCheckBox *_useOpenGL;
 	QCheckBox *_enableHTTP2;
@@ -1,8 +1,10 @@
 #include <cmath>
+#include <cfloat>
 #include <QCursor>
 #include <QPainter>
 #include <QGraphicsSceneMouseEvent>
 #include "common/greatcircle.h"
+#include "common/wgs84.h"
 #include "map/map.h"
 #include "pathtickitem.h"
 #include "popup.h"
@@ -18,6 +20,19 @@
 #endif // QT 5.15
 
 #define GEOGRAPHICAL_MILE 1855.3248
+#define LOD_TOLERANCE     0.5 /* px */
+#define CLIP_THRESHOLD    1024 /* path elements */
+
+class Span
+{
+public:
+	Span() : first(0), last(0), tolerance(0) {}
+	Span(int first, int last, float tolerance)
+	  : first(first), last(last), tolerance(tolerance) {}
+
+	int first, last;
+	float tolerance;
+};
 
 Units PathItem::_units = Metric;
 QTimeZone PathItem::_timeZone = QTimeZone::utc();
@@ -32,6 +47,132 @@ static inline unsigned segments(qreal distance)
 	return ceil(distance / GEOGRAPHICAL_MILE);
 }
 
+static qreal distance(const QPointF &p, const QPointF &a, const QPointF &b)
+{
+	QPointF ab(b - a), ap(p - a);
+	qreal l2 = ab.x() * ab.x() + ab.y() * ab.y();
+	qreal t = (l2 > 0) ? (ap.x() * ab.x() + ap.y() * ab.y()) / l2 : 0;
+
+	if (t <= 0)
+		return sqrt(ap.x() * ap.x() + ap.y() * ap.y());
+	if (t >= 1) {
+		QPointF bp(p - b);
+		return sqrt(bp.x() * bp.x() + bp.y() * bp.y());
+	}
+
+	QPointF d(ap - ab * t);
+	return sqrt(d.x() * d.x() + d.y() * d.y());
+}
+
+/* Douglas-Peucker simplification hierarchy. Every point gets the tolerance
+   (in meters) up to which it is a part of the simplified segment, so the
+   segment can be simplified for any tolerance with a single pass. */
+static QVector<float> simplify(const PathSegment &segment)
+{
+	QVector<float> lod(segment.size(), 0);
+	QVector<QPointF> pts(segment.size());
+	QVector<Span> stack;
+
+	if (segment.isEmpty())
+		return lod;
+
+	// Local equirectangular projection in meters
+	qreal ky = deg2rad(WGS84_RADIUS);
+	qreal kx = ky * cos(deg2rad(segment.at(segment.size() / 2).coordinates()
+	  .lat()));
+	for (int i = 0; i < segment.size(); i++) {
+		const Coordinates &c = segment.at(i).coordinates();
+		pts[i] = QPointF(c.lon() * kx, c.lat() * ky);
+	}
+
+	lod.first() = FLT_MAX;
+	lod.last() = FLT_MAX;
+
+	stack.append(Span(0, segment.size() - 1, FLT_MAX));
+	while (!stack.isEmpty()) {
+		Span s(stack.last());
+		stack.removeLast();
+
+		qreal max = -1;
+		int index = -1;
+		for (int i = s.first + 1; i < s.last; i++) {
+			qreal d = distance(pts.at(i), pts.at(s.first), pts.at(s.last));
+			if (d > max) {
+				max = d;
+				index = i;
+			}
+		}
+		if (index < 0)
+			continue;
+
+		/* The tolerance must not grow down the hierarchy, otherwise a point
+		   could be present without the points it has been split by */
+		float t = qMin((float)max, s.tolerance);
+		lod[index] = t;
+		stack.append(Span(s.first, index, t));
+		stack.append(Span(index, s.last, t));
+	}
+
+	return lod;
+}
+
+static inline bool intersects(const QRectF &rect, const QPointF &p1,
+  const QPointF &p2)
+{
+	return (qMax(p1.x(), p2.x()) >= rect.left()
+	  && qMin(p1.x(), p2.x()) <= rect.right()
+	  && qMax(p1.y(), p2.y()) >= rect.top()
+	  && qMin(p1.y(), p2.y()) <= rect.bottom());
+}
+
+class HitContext
+{
+public:
+	HitContext(const QPainterPath &path, const QPointF &point, qreal radius)
+	  : path(path), point(point), radius(radius), hit(false) {}
+
+	const QPainterPath &path;
+	QPointF point;
+	qreal radius;
+	bool hit;
+};
+
+static bool hitCb(int index, void *context)
+{
+	HitContext *ctx = (HitContext*)context;
+	const QPainterPath::Element &e1 = ctx->path.elementAt(index - 1);
+	const QPainterPath::Element &e2 = ctx->path.elementAt(index);
+
+	ctx->hit = (distance(ctx->point, QPointF(e1.x, e1.y), QPointF(e2.x, e2.y))
+	  <= ctx->radius);
+
+	return !ctx->hit;
+}
+
+static QPainterPath clip(const QPainterPath &path, const QRectF &rect)
+{
+	QPainterPath clipped;
+	QPointF last;
+	bool connected = false;
+
+	for (int i = 0; i < path.elementCount(); i++) {
+		const QPainterPath::Element &e = path.elementAt(i);
+		QPointF p(e.x, e.y);
+
+		if (e.isLineTo() && intersects(rect, last, p)) {
+			if (!connected)
+				clipped.moveTo(last);
+			clipped.lineTo(p);
+			connected = true;
+		} else
+			connected = false;
+
+		last = p;
+	}
+
+	return clipped;
+}
+
 PathItem::PathItem(const Path &path, Map *map, QGraphicsItem *parent)
   : GraphicsItem(parent), _path(path), _map(map), _graph(0)
 {
@@ -47,6 +188,10 @@ PathItem::PathItem(const Path &path, Map *map, QGraphicsItem *parent)
 
 	_pen = QPen(color(), width());
 
+	_lod.reserve(_path.size());
+	for (int i = 0; i < _path.size(); i++)
+		_lod.append(simplify(_path.at(i)));
+
 	updatePainterPath();
 	updateShape();
 	updateTicks();
@@ -60,13 +205,84 @@ PathItem::PathItem(const Path &path, Map *map, QGraphicsItem *parent)
 
 	setCursor(Qt::ArrowCursor);
 	setAcceptHoverEvents(true);
+	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+qreal PathItem::shapeWidth() const
+{
+	return (_width + 1) * pow(2, -_digitalZoom);
 }
 
 void PathItem::updateShape()
 {
-	QPainterPathStroker s;
-	s.setWidth((_width + 1) * pow(2, -_digitalZoom));
-	_shape = s.createStroke(_painterPath);
+	qreal hw = shapeWidth() / 2;
+
+	_boundingRect = _painterPath.boundingRect().adjusted(-hw, -hw, hw, hw);
+	_shape = QPainterPath();
+}
+
+void PathItem::updateTree()
+{
+	_tree.RemoveAll();
+
+	for (int i = 1; i < _painterPath.elementCount(); i++) {
+		const QPainterPath::Element &e1 = _painterPath.elementAt(i - 1);
+		const QPainterPath::Element &e2 = _painterPath.elementAt(i);
+		if (!e2.isLineTo())
+			continue;
+
+		qreal min[2], max[2];
+		min[0] = qMin(e1.x, e2.x);
+		min[1] = qMin(e1.y, e2.y);
+		max[0] = qMax(e1.x, e2.x);
+		max[1] = qMax(e1.y, e2.y);
+		_tree.Insert(min, max, i);
+	}
+}
+
+QPainterPath PathItem::shape() const
+{
+	/* The stroke is expensive to create and it is not needed for the hit
+	   testing (see hit()), so it is created only when explicitly required. */
+	if (_shape.isEmpty()) {
+		QPainterPathStroker s;
+		s.setWidth(shapeWidth());
+		_shape = s.createStroke(_painterPath);
+	}
+
+	return _shape;
+}
+
+bool PathItem::hit(const QPointF &point, qreal radius) const
+{
+	HitContext ctx(_painterPath, point, radius);
+	qreal min[2], max[2];
+
+	min[0] = point.x() - radius;
+	min[1] = point.y() - radius;
+	max[0] = point.x() + radius;
+	max[1] = point.y() + radius;
+	_tree.Search(min, max, hitCb, &ctx);
+
+	return ctx.hit;
+}
+
+bool PathItem::contains(const QPointF &point) const
+{
+	return hit(point, shapeWidth() / 2);
+}
+
+bool PathItem::collidesWithPath(const QPainterPath &path,
+  Qt::ItemSelectionMode mode) const
+{
+	if (mode != Qt::IntersectsItemShape)
+		return GraphicsItem::collidesWithPath(path, mode);
+
+	/* The scene hit-tests the items with small (1px) rectangles, handle them
+	   as points with the appropriate radius */
+	QRectF br(path.boundingRect());
+	return hit(br.center(), shapeWidth() / 2 + qMax(br.width(),
+	  br.height()) / 2);
 }
 
 void PathItem::addSegment(const Coordinates &c1, const Coordinates &c2)
@@ -95,17 +311,37 @@ void PathItem::addSegment(const Coordinates &c1, const Coordinates &c2)
 		_painterPath.lineTo(_map->ll2xy(c2));
 }
 
+qreal PathItem::tolerance() const
+{
+	RectC br(_path.boundingRect());
+	qreal res = _map->resolution(QRectF(_map->ll2xy(br.topLeft()),
+	  _map->ll2xy(br.bottomRight())));
+
+	return std::isnan(res)
+	  ? 0 : LOD_TOLERANCE * res * pow(2, -_digitalZoom);
+}
+
 void PathItem::updatePainterPath()
 {
+	qreal tol = tolerance();
+
 	_painterPath = QPainterPath();
+	_visibleRect = QRectF();
 
 	for (int i = 0; i < _path.size(); i++) {
 		const PathSegment &segment = _path.at(i);
+		const QVector<float> &lod = _lod.at(i);
+		int last = 0;
+
 		_painterPath.moveTo(_map->ll2xy(segment.first().coordinates()));
 
 		for (int j = 1; j < segment.size(); j++) {
-			const PathPoint &p1 = segment.at(j-1);
+			if (lod.at(j) < tol)
+				continue;
+
+			const PathPoint &p1 = segment.at(last);
 			const PathPoint &p2 = segment.at(j);
+			last = j;
 			unsigned n = segments(p2.distance() - p1.distance());
 
 			if (n > 1) {
@@ -121,16 +357,17 @@ void PathItem::updatePainterPath()
 				addSegment(p1.coordinates(), p2.coordinates());
 		}
 	}
+
+	updateTree();
 }
 
 void PathItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 	  QWidget *widget)
 {
-	Q_UNUSED(option);
 	Q_UNUSED(widget);
 
 	painter->setPen(_pen);
-	painter->drawPath(_painterPath);
+	painter->drawPath(visiblePath(option->exposedRect));
 
 /*
 	painter->setPen(Qt::red);
@@ -138,6 +375,22 @@ void PathItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 */
 }
 
+const QPainterPath &PathItem::visiblePath(const QRectF &rect)
+{
+	if (_painterPath.elementCount() < CLIP_THRESHOLD || rect.isEmpty())
+		return _painterPath;
+
+	if (!_visibleRect.contains(rect)) {
+		/* Clip the path with some margin so that it does not have to be
+		   clipped again on every small move of the view */
+		_visibleRect = rect.adjusted(-rect.width() / 2, -rect.height() / 2,
+		  rect.width() / 2, rect.height() / 2);
+		_visiblePath = clip(_painterPath, _visibleRect);
+	}
+
+	return _visiblePath;
+}
+
 void PathItem::setMap(Map *map)
 {
 	prepareGeometryChange();
@@ -229,6 +482,7 @@ void PathItem::setDigitalZoom(int zoom)
 	for (int i = 0; i < _ticks.size(); i++)
 		_ticks.at(i)->setDigitalZoom(zoom);
 
+	updatePainterPath();
 	updateShape();
 }
 
@@ -3,6 +3,7 @@
 
 #include <QPen>
 #include <QTimeZone>
+#include "common/rtree.h"
 #include "data/path.h"
 #include "graphicsscene.h"
 #include "markerinfoitem.h"
@@ -22,8 +23,11 @@ public:
 	PathItem(const Path &path, Map *map, QGraphicsItem *parent = 0);
 	virtual ~PathItem() {}
 
-	QPainterPath shape() const {return _shape;}
-	QRectF boundingRect() const {return _shape.boundingRect();}
+	QPainterPath shape() const;
+	QRectF boundingRect() const {return _boundingRect;}
+	bool contains(const QPointF &point) const;
+	bool collidesWithPath(const QPainterPath &path,
+	  Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const;
 	void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
 	  QWidget *widget);
 
@@ -69,10 +73,17 @@ protected:
 	static QTimeZone _timeZone;
 
 private:
+	typedef RTree<int, qreal, 2> SegmentTree;
+
 	const PathSegment *segment(qreal x) const;
 	QPointF position(qreal distance) const;
 	void updatePainterPath();
 	void updateShape();
+	void updateTree();
+	bool hit(const QPointF &point, qreal radius) const;
+	qreal shapeWidth() const;
+	qreal tolerance() const;
+	const QPainterPath &visiblePath(const QRectF &rect);
 	void addSegment(const Coordinates &c1, const Coordinates &c2);
 	void setMarkerInfo(qreal pos);
 	void updateColor();
@@ -95,8 +106,13 @@ private:
 	QVector<PathTickItem*> _ticks;
 
 	QPen _pen;
-	QPainterPath _shape;
+	mutable QPainterPath _shape;
+	QRectF _boundingRect;
 	QPainterPath _painterPath;
+	SegmentTree _tree;
+	QPainterPath _visiblePath;
+	QRectF _visibleRect;
+	QVector<QVector<float> > _lod;
 
 	qreal _width;
 	QColor _color;
@@ -35,9 +35,11 @@
 #ifdef Q_OS_ANDROID
 #define PIXMAP_CACHE 256
 #define DEM_CACHE    128
+#define MAPDATA_CACHE 64
 #else // Q_OS_ANDROID
 #define PIXMAP_CACHE 512
 #define DEM_CACHE    256
+#define MAPDATA_CACHE 128
 #endif // Q_OS_ANDROID
 
 
@@ -246,6 +248,9 @@ SETTING(useOpenGL,           "useOpenGL",              false                  );
 SETTING(enableHTTP2,         "enableHTTP2",            true                   );
 SETTING(pixmapCache,         "pixmapCache",            PIXMAP_CACHE           );
 SETTING(demCache,            "demCache",               DEM_CACHE              );
+SETTING(mapDataCache,        "mapDataCache",           MAPDATA_CACHE          );
+SETTING(imagePyramid,        "imagePyramid",           true                   );
+SETTING(tilePrefetch,        "tilePrefetch",           16                     );
 SETTING(connectionTimeout,   "connectionTimeout",      30                     );
 SETTING(hiresPrint,          "hiresPrint",             false                  );
 SETTING(printName,           "printName",              true                   );
@@ -190,6 +190,9 @@ public:
 	static const Setting enableHTTP2;
 	static const Setting pixmapCache;
 	static const Setting demCache;
+	static const Setting mapDataCache;
+	static const Setting imagePyramid;
+	static const Setting tilePrefetch;
 	static const Setting connectionTimeout;
 	static const Setting hiresPrint;
 	static const Setting printName;
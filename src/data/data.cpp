@@ -1,6 +1,7 @@
 #include <QApplication>
 #include <QFile>
 #include <QFileInfo>
+#include <QThreadStorage>
 #include "gpxparser.h"
 #include "tcxparser.h"
 #include "csvparser.h"
@@ -23,65 +24,82 @@
 #include "data.h"
 
 
-static GPXParser gpx;
-static TCXParser tcx;
-static KMLParser kml;
-static FITParser fit;
-static CSVParser csv;
-static IGCParser igc;
-static NMEAParser nmea;
-static PLTParser plt;
-static WPTParser wpt;
-static RTEParser rte;
-static LOCParser loc;
-static SLFParser slf;
-static GeoJSONParser geojson;
-static EXIFParser exif;
-static CUPParser cup;
-static GPIParser gpi;
-static SMLParser sml;
-static OV2Parser ov2;
-static ITNParser itn;
-static OMDParser omd;
-static GHPParser ghp;
-static TwoNavParser twonav;
-
-static QMultiMap<QString, Parser*> parsers()
+/* The parsers keep the parsing state in their members, so every thread
+   loading data files has its own instances. */
+class Parsers
 {
-	QMultiMap<QString, Parser*> map;
-
-	map.insert("gpx", &gpx);
-	map.insert("tcx", &tcx);
-	map.insert("kml", &kml);
-	map.insert("kmz", &kml);
-	map.insert("fit", &fit);
-	map.insert("csv", &csv);
-	map.insert("igc", &igc);
-	map.insert("nmea", &nmea);
-	map.insert("plt", &plt);
-	map.insert("wpt", &wpt);
-	map.insert("rte", &rte);
-	map.insert("loc", &loc);
-	map.insert("slf", &slf);
-	map.insert("json", &geojson);
-	map.insert("geojson", &geojson);
-	map.insert("jpeg", &exif);
-	map.insert("jpg", &exif);
-	map.insert("cup", &cup);
-	map.insert("gpi", &gpi);
-	map.insert("sml", &sml);
-	map.insert("ov2", &ov2);
-	map.insert("itn", &itn);
-	map.insert("omd", &omd);
-	map.insert("ghp", &ghp);
-	map.insert("trk", &twonav);
-	map.insert("rte", &twonav);
-	map.insert("wpt", &twonav);
-
-	return map;
+public:
+	Parsers();
+
+	const QMultiMap<QString, Parser*> &map() const {return _map;}
+
+private:
+	GPXParser _gpx;
+	TCXParser _tcx;
+	KMLParser _kml;
+	FITParser _fit;
+	CSVParser _csv;
+	IGCParser _igc;
+	NMEAParser _nmea;
+	PLTParser _plt;
+	WPTParser _wpt;
+	RTEParser _rte;
+	LOCParser _loc;
+	SLFParser _slf;
+	GeoJSONParser _geojson;
+	EXIFParser _exif;
+	CUPParser _cup;
+	GPIParser _gpi;
+	SMLParser _sml;
+	OV2Parser _ov2;
+	ITNParser _itn;
+	OMDParser _omd;
+	GHPParser _ghp;
+	TwoNavParser _twonav;
+
+	QMultiMap<QString, Parser*> _map;
+};
+
+Parsers::Parsers()
+{
+	_map.insert("gpx", &_gpx);
+	_map.insert("tcx", &_tcx);
+	_map.insert("kml", &_kml);
+	_map.insert("kmz", &_kml);
+	_map.insert("fit", &_fit);
+	_map.insert("csv", &_csv);
+	_map.insert("igc", &_igc);
+	_map.insert("nmea", &_nmea);
+	_map.insert("plt", &_plt);
+	_map.insert("wpt", &_wpt);
+	_map.insert("rte", &_rte);
+	_map.insert("loc", &_loc);
+	_map.insert("slf", &_slf);
+	_map.insert("json", &_geojson);
+	_map.insert("geojson", &_geojson);
+	_map.insert("jpeg", &_exif);
+	_map.insert("jpg", &_exif);
+	_map.insert("cup", &_cup);
+	_map.insert("gpi", &_gpi);
+	_map.insert("sml", &_sml);
+	_map.insert("ov2", &_ov2);
+	_map.insert("itn", &_itn);
+	_map.insert("omd", &_omd);
+	_map.insert("ghp", &_ghp);
+	_map.insert("trk", &_twonav);
+	_map.insert("rte", &_twonav);
+	_map.insert("wpt", &_twonav);
 }
 
-QMultiMap<QString, Parser*> Data::_parsers = parsers();
+static QThreadStorage<Parsers*> parsers;
+
+static const QMultiMap<QString, Parser*> &parserMap()
+{
+	if (!parsers.hasLocalData())
+		parsers.setLocalData(new Parsers());
+
+	return parsers.localData()->map();
+}
 
 void Data::processData(QList<TrackData> &trackData, QList<RouteData> &routeData)
 {
@@ -106,10 +124,11 @@ Data::Data(const QString &fileName, bool tryUnknown)
 		return;
 	}
 
-	QMultiMap<QString, Parser*>::iterator it;
+	const QMultiMap<QString, Parser*> &map = parserMap();
+	QMultiMap<QString, Parser*>::const_iterator it;
 	QString suffix(fi.suffix().toLower());
-	if ((it = _parsers.find(suffix)) != _parsers.end()) {
-		while (it != _parsers.end() && it.key() == suffix) {
+	if ((it = map.find(suffix)) != map.end()) {
+		while (it != map.end() && it.key() == suffix) {
 			if (it.value()->parse(&file, trackData, routeData, _polygons,
 			  _waypoints)) {
 				processData(trackData, routeData);
@@ -124,13 +143,13 @@ Data::Data(const QString &fileName, bool tryUnknown)
 		}
 
 		qWarning("%s:", qPrintable(fileName));
-		for (it = _parsers.find(suffix); it != _parsers.end()
+		for (it = map.find(suffix); it != map.end()
 		  && it.key() == suffix; it++)
 			qWarning("  %s: line %d: %s", qPrintable(it.key()),
 			  it.value()->errorLine(), qPrintable(it.value()->errorString()));
 
 	} else if (tryUnknown) {
-		for (it = _parsers.begin(); it != _parsers.end(); it++) {
+		for (it = map.begin(); it != map.end(); it++) {
 			if (it.value()->parse(&file, trackData, routeData, _polygons,
 			  _waypoints)) {
 				processData(trackData, routeData);
@@ -141,7 +160,7 @@ Data::Data(const QString &fileName, bool tryUnknown)
 		}
 
 		qWarning("%s:", qPrintable(fileName));
-		for (it = _parsers.begin(); it != _parsers.end(); it++)
+		for (it = map.begin(); it != map.end(); it++)
 			qWarning("  %s: line %d: %s", qPrintable(it.key()),
 			  it.value()->errorLine(), qPrintable(it.value()->errorString()));
 
@@ -179,10 +198,11 @@ QString Data::formats()
 QStringList Data::filter()
 {
 	QStringList filter;
+	const QMultiMap<QString, Parser*> &map = parserMap();
 	QString last;
 
-	for (QMultiMap<QString, Parser*>::iterator it = _parsers.begin();
-	  it != _parsers.end(); it++) {
+	for (QMultiMap<QString, Parser*>::const_iterator it = map.begin();
+	  it != map.end(); it++) {
 		if (it.key() != last)
 			filter << "*." + it.key();
 		last = it.key();
@@ -38,8 +38,6 @@ private:
 	QList<Route> _routes;
 	QList<Area> _polygons;
 	QVector<Waypoint> _waypoints;
-
-	static QMultiMap<QString, Parser*> _parsers;
 };
 
 #endif // DATA_H
@@ -0,0 +1,98 @@
+#include <QtConcurrent>
+#include "dataloader.h"
+
+
+static QSharedPointer<Data> loadFile(const QString &fileName)
+{
+	return QSharedPointer<Data>(new Data(fileName));
+}
+
+DataLoader::DataLoader(QObject *parent)
+  : QObject(parent), _next(0), _done(0), _total(0)
+{
+	connect(&_watcher, &QFutureWatcher<QSharedPointer<Data> >::resultReadyAt,
+	  this, &DataLoader::resultReady);
+	connect(&_watcher, &QFutureWatcher<QSharedPointer<Data> >::finished,
+	  this, &DataLoader::loadFinished);
+}
+
+DataLoader::~DataLoader()
+{
+	_watcher.cancel();
+	_watcher.waitForFinished();
+}
+
+void DataLoader::start(const QStringList &files)
+{
+	_files = files;
+	_next = 0;
+	_watcher.setFuture(QtConcurrent::mapped(_files, loadFile));
+}
+
+void DataLoader::load(const QStringList &files)
+{
+	/* The running batch is not interrupted, the files are loaded after it */
+	if (isRunning()) {
+		_queue.append(files);
+		_total += files.size();
+		emit queued(_total);
+		return;
+	}
+
+	_done = 0;
+	_total = files.size();
+	start(files);
+}
+
+void DataLoader::cancel()
+{
+	/* The files that are already being parsed can not be interrupted, their
+	   results are dropped when they finish. */
+	_queue.clear();
+	_watcher.cancel();
+}
+
+void DataLoader::resultReady(int index)
+{
+	Q_UNUSED(index);
+
+	if (_watcher.isCanceled())
+		return;
+
+	/* Keep the files order, a result is reported only when all the preceding
+	   files have been reported. */
+	QFuture<QSharedPointer<Data> > future(_watcher.future());
+	while (_next < _files.size() && future.isResultReadyAt(_next)) {
+		QSharedPointer<Data> data(future.resultAt(_next));
+		emit loaded(_files.at(_next), *data);
+		_next++;
+		emit progress(++_done);
+
+		if (_watcher.isCanceled())
+			break;
+	}
+}
+
+void DataLoader::loadFinished()
+{
+	/* Replacing the future emits finished() once again */
+	if (_files.isEmpty())
+		return;
+
+	/* Continue with the queued files (cancel() clears the queue, so these
+	   were requested after it). The future is replaced directly with the new
+	   running one, so no extra finished() is emitted. */
+	if (!_queue.isEmpty()) {
+		QStringList files(_queue);
+		_queue.clear();
+		start(files);
+		return;
+	}
+
+	/* Release the parsed data, the results are held by the future until it
+	   is replaced. */
+	_watcher.setFuture(QFuture<QSharedPointer<Data> >());
+	_files.clear();
+
+	emit finished();
+}
@@ -0,0 +1,50 @@
+#ifndef DATALOADER_H
+#define DATALOADER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QFutureWatcher>
+#include "data.h"
+
+/* Parses data files in the global thread pool. The loaded data are reported
+   in the order of the files list as soon as they (and all the preceding
+   files) are parsed. Files requested while a load is running are queued and
+   loaded after the running batch, finished() is emitted once all the queued
+   files have been loaded. */
+class DataLoader : public QObject
+{
+	Q_OBJECT
+
+public:
+	DataLoader(QObject *parent = 0);
+	~DataLoader();
+
+	void load(const QStringList &files);
+	bool isRunning() const {return !_files.isEmpty();}
+
+public slots:
+	void cancel();
+
+signals:
+	void loaded(const QString &fileName, const Data &data);
+	void progress(int done);
+	void queued(int total);
+	void finished();
+
+private slots:
+	void resultReady(int index);
+	void loadFinished();
+
+private:
+	void start(const QStringList &files);
+
+	QStringList _files;
+	QStringList _queue;
+	QFutureWatcher<QSharedPointer<Data> > _watcher;
+	int _next;
+	int _done;
+	int _total;
+};
+
+#endif // DATALOADER_H
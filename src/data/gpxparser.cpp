@@ -1,11 +1,113 @@
+#include <climits>
 #include "address.h"
 #include "gpxparser.h"
 
 
+/* Minimal number of trackpoints in a segment to estimate the segment size */
+#define RESERVE_THRESHOLD 1024
+
+static inline int digits(const QChar *str, int len)
+{
+	int val = 0;
+
+	for (int i = 0; i < len; i++) {
+		ushort c = str[i].unicode();
+		if (c < '0' || c > '9')
+			return -1;
+		val = val * 10 + (c - '0');
+	}
+
+	return val;
+}
+
+/* Fast path for the YYYY-MM-DDThh:mm:ss[.s+][Z|(+|-)hh[[:]mm]] format used by
+   virtually all GPX files. Everything else is left to QDateTime. */
+static QDateTime dateTime(const QString &str)
+{
+	const QChar *s = str.constData();
+	int len = str.size();
+
+	if (len < 19 || s[4] != QLatin1Char('-') || s[7] != QLatin1Char('-')
+	  || s[10] != QLatin1Char('T') || s[13] != QLatin1Char(':')
+	  || s[16] != QLatin1Char(':'))
+		return QDateTime::fromString(str, Qt::ISODate);
+
+	QDate date(digits(s, 4), digits(s + 5, 2), digits(s + 8, 2));
+	QTime time(digits(s + 11, 2), digits(s + 14, 2), digits(s + 17, 2));
+	if (!(date.isValid() && time.isValid()))
+		return QDateTime::fromString(str, Qt::ISODate);
+
+	int i = 19;
+	qint64 msecs = 0;
+	if (i < len && s[i] == QLatin1Char('.')) {
+		qint64 frac = 0, scale = 1;
+		for (i++; i < len && s[i].isDigit(); i++) {
+			if (scale < 1000000000) {
+				frac = frac * 10 + s[i].digitValue();
+				scale *= 10;
+			}
+		}
+		if (scale == 1)
+			return QDateTime::fromString(str, Qt::ISODate);
+		msecs = (frac * 1000 + scale / 2) / scale;
+	}
+
+	if (i == len)
+		return QDateTime(date, time).addMSecs(msecs);
+	if (s[i] == QLatin1Char('Z') && i + 1 == len)
+		return QDateTime(date, time, Qt::UTC).addMSecs(msecs);
+	if (s[i] != QLatin1Char('+') && s[i] != QLatin1Char('-'))
+		return QDateTime::fromString(str, Qt::ISODate);
+
+	int sign = (s[i] == QLatin1Char('-')) ? -1 : 1;
+	int hh, mm = 0;
+	int zl = len - i - 1;
+	if (zl == 2)
+		hh = digits(s + i + 1, 2);
+	else if (zl == 4) {
+		hh = digits(s + i + 1, 2);
+		mm = digits(s + i + 3, 2);
+	} else if (zl == 5 && s[i + 3] == QLatin1Char(':')) {
+		hh = digits(s + i + 1, 2);
+		mm = digits(s + i + 4, 2);
+	} else
+		return QDateTime::fromString(str, Qt::ISODate);
+	if (hh < 0 || mm < 0)
+		return QDateTime::fromString(str, Qt::ISODate);
+
+	return QDateTime(date, time, Qt::UTC).addMSecs(msecs
+	  - sign * (hh * 3600 + mm * 60) * 1000LL);
+}
+
+/* Reads the element text into the _text buffer. The buffer is reused, so no
+   string is allocated for the (numerous) trackpoint values. */
+void GPXParser::readText()
+{
+	_text.resize(0);
+
+	while (!_reader.atEnd()) {
+		switch (_reader.readNext()) {
+			case QXmlStreamReader::Characters:
+			case QXmlStreamReader::EntityReference:
+				_text.append(_reader.text());
+				break;
+			case QXmlStreamReader::EndElement:
+				return;
+			case QXmlStreamReader::StartElement:
+				_reader.raiseError("Expected character data");
+				return;
+			default:
+				break;
+		}
+	}
+}
+
 qreal GPXParser::number()
 {
 	bool res;
-	qreal ret = _reader.readElementText().toDouble(&res);
+
+	readText();
+	qreal ret = _text.toDouble(&res);
 	if (!res)
 		_reader.raiseError(QString("Invalid %1").arg(
 		  _reader.name().toString()));
@@ -15,8 +117,8 @@ qreal GPXParser::number()
 
 QDateTime GPXParser::time()
 {
-	QDateTime d = QDateTime::fromString(_reader.readElementText(),
-	  Qt::ISODate);
+	readText();
+	QDateTime d(dateTime(_text));
 	if (!d.isValid())
 		_reader.raiseError(QString("Invalid %1").arg(
 		  _reader.name().toString()));
@@ -44,12 +146,12 @@ Coordinates GPXParser::coordinates()
 	bool res;
 	const QXmlStreamAttributes &attr = _reader.attributes();
 
-	qreal lon = attr.value("lon").toDouble(&res);
+	qreal lon = attr.value(QLatin1String("lon")).toDouble(&res);
 	if (!res || (lon < -180.0 || lon > 180.0)) {
 		_reader.raiseError("Invalid longitude");
 		return Coordinates();
 	}
-	qreal lat = attr.value("lat").toDouble(&res);
+	qreal lat = attr.value(QLatin1String("lat")).toDouble(&res);
 	if (!res || (lat < -90.0 || lat > 90.0)) {
 		_reader.raiseError("Invalid latitude");
 		return Coordinates();
@@ -218,15 +320,37 @@ void GPXParser::waypointData(Waypoint &waypoint, SegmentData *autoRoute)
 		waypoint.setElevation(waypoint.elevation() - gh);
 }
 
+void GPXParser::reserve(SegmentData &segment, qint64 start)
+{
+	/* Estimate the number of the remaining trackpoints from the size of the
+	   already parsed ones. For files with multiple segments the estimate is
+	   too big, the excess is released when the segment is complete. */
+	qint64 parsed = _reader.characterOffset() - start;
+	qint64 remaining = _reader.device()->size() - _reader.characterOffset();
+	if (parsed <= 0 || remaining <= 0)
+		return;
+
+	qint64 size = segment.size() + remaining * segment.size() / parsed;
+	segment.reserve((int)qMin(size, (qint64)INT_MAX / 2));
+}
+
 void GPXParser::trackpoints(SegmentData &segment)
 {
+	qint64 start = _reader.characterOffset();
+
 	while (_reader.readNextStartElement()) {
 		if (_reader.name() == QLatin1String("trkpt")) {
+			if (segment.size() == RESERVE_THRESHOLD)
+				reserve(segment, start);
 			segment.append(Trackpoint(coordinates()));
 			trackpointData(segment.last());
 		} else
 			_reader.skipCurrentElement();
 	}
+
+	if (segment.size() > RESERVE_THRESHOLD
+	  && segment.capacity() - segment.size() > segment.size() / 2)
+		segment.squeeze();
 }
 
 void GPXParser::routeExtension(RouteData &route)
@@ -32,12 +32,15 @@ private:
 	void trackpointData(Trackpoint &trackpoint);
 	void waypointData(Waypoint &waypoint, SegmentData *autoRoute = 0);
 	void address(Waypoint &waypoint);
+	void reserve(SegmentData &segment, qint64 start);
+	void readText();
 	qreal number();
 	QDateTime time();
 	Coordinates coordinates();
 	Link link();
 
 	QXmlStreamReader _reader;
+	QString _text;
 };
 
 #endif // GPXPARSER_H
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <QFileInfo>
+#include "atlasdata.h"
+
+using namespace ENC;
+
+#define CACHE_SIZE 67108864 /* 64MB of cell files */
+
+static void rectcBounds(const RectC &rect, double min[2], double max[2])
+{
+	min[0] = rect.left();
+	min[1] = rect.bottom();
+	max[0] = rect.right();
+	max[1] = rect.top();
+}
+
+static bool cellCb(AtlasData::Cell *cell, void *context)
+{
+	QList<AtlasData::Cell*> *list = (QList<AtlasData::Cell*>*)context;
+	list->append(cell);
+
+	return true;
+}
+
+static bool lessDetailed(const AtlasData::Cell *c1, const AtlasData::Cell *c2)
+{
+	return c1->band() < c2->band();
+}
+
+/* Removes the area of the rectangle r from the list of disjoint rectangles */
+static void subtract(QList<RectC> &list, const RectC &r)
+{
+	QList<RectC> rest;
+
+	for (int i = 0; i < list.size(); i++) {
+		const RectC &a = list.at(i);
+		RectC is(a & r);
+
+		if (!is.isValid()) {
+			rest.append(a);
+			continue;
+		}
+
+		if (a.top() > is.top())
+			rest.append(RectC(Coordinates(a.left(), a.top()),
+			  Coordinates(a.right(), is.top())));
+		if (is.bottom() > a.bottom())
+			rest.append(RectC(Coordinates(a.left(), is.bottom()),
+			  Coordinates(a.right(), a.bottom())));
+		if (is.left() > a.left())
+			rest.append(RectC(Coordinates(a.left(), is.top()),
+			  Coordinates(is.left(), is.bottom())));
+		if (a.right() > is.right())
+			rest.append(RectC(Coordinates(is.right(), is.top()),
+			  Coordinates(a.right(), is.bottom())));
+	}
+
+	list = rest;
+}
+
+static bool intersects(const QList<RectC> &list, const RectC &r)
+{
+	for (int i = 0; i < list.size(); i++)
+		if ((list.at(i) & r).isValid())
+			return true;
+
+	return false;
+}
+
+static int band(const QString &path)
+{
+	/* The third character of the S-57 cell file name is the intended usage
+	   (navigational purpose) of the cell */
+	QString name(QFileInfo(path).fileName());
+	if (name.size() < 3)
+		return 0;
+
+	int band = name.at(2).digitValue();
+	return (band >= 1 && band <= 6) ? band : 0;
+}
+
+AtlasData::~AtlasData()
+{
+	qDeleteAll(_list);
+}
+
+void AtlasData::addCell(const QString &path, const RectC &bounds)
+{
+	double min[2], max[2];
+	Cell *cell = new Cell(path, bounds, ::band(path), QFileInfo(path).size());
+
+	rectcBounds(bounds, min, max);
+	_cells.Insert(min, max, cell);
+	_list.append(cell);
+
+	_bounds |= bounds;
+	_bands |= 1U<<cell->band();
+}
+
+Range AtlasData::bandZooms(int band)
+{
+	switch (band) {
+		case 1:
+			return Range(0, 6);
+		case 2:
+			return Range(7, 9);
+		case 3:
+			return Range(10, 11);
+		case 4:
+			return Range(12, 13);
+		case 5:
+			return Range(14, 16);
+		case 6:
+			return Range(17, 20);
+		default:
+			return Range(0, 20);
+	}
+}
+
+int AtlasData::band(int zoom) const
+{
+	int band = 0;
+
+	/* The most detailed band suitable for the zoom or the least detailed
+	   band when there is no such band */
+	for (int i = 1; i <= 6; i++) {
+		if (!(_bands & (1U<<i)))
+			continue;
+		if (!band || bandZooms(i).min() <= zoom)
+			band = i;
+	}
+
+	return band;
+}
+
+int AtlasData::zoomBand(int zoom)
+{
+	for (int i = 6; i > 1; i--)
+		if (bandZooms(i).min() <= zoom)
+			return i;
+
+	return 1;
+}
+
+void AtlasData::select(const RectC &rect, int zoom, QList<Cell*> &cells,
+  QList<Cell*> &list)
+{
+	int max = zoomBand(zoom);
+	QList<RectC> uncovered;
+	uncovered.append(rect);
+
+	std::stable_sort(cells.begin(), cells.end(), lessDetailed);
+
+	/* Cells with unknown band are used at all zooms */
+	for (int i = 0; i < cells.size() && !cells.at(i)->band(); i++)
+		list.append(cells.at(i));
+
+	/* Every area is covered by the most detailed cells suitable for the zoom,
+	   less detailed cells are only used where there are no such cells */
+	for (int i = cells.size() - 1; i >= 0 && !uncovered.isEmpty(); i--) {
+		Cell *cell = cells.at(i);
+		if (!cell->band() || cell->band() > max)
+			continue;
+		if (intersects(uncovered, cell->bounds())) {
+			list.append(cell);
+			subtract(uncovered, cell->bounds());
+		}
+	}
+
+	/* Areas covered only by more detailed cells than suitable for the zoom
+	   use the least detailed of them */
+	for (int i = 0; i < cells.size() && !uncovered.isEmpty(); i++) {
+		Cell *cell = cells.at(i);
+		if (cell->band() <= max)
+			continue;
+		if (intersects(uncovered, cell->bounds())) {
+			list.append(cell);
+			subtract(uncovered, cell->bounds());
+		}
+	}
+
+	/* The more detailed data is drawn over the less detailed data */
+	std::stable_sort(list.begin(), list.end(), lessDetailed);
+}
+
+Range AtlasData::zooms() const
+{
+	int min = 0;
+
+	for (int i = 1; i <= 6; i++) {
+		if (_bands & (1U<<i)) {
+			min = bandZooms(i).min();
+			break;
+		}
+	}
+
+	return Range(min, 20);
+}
+
+void AtlasData::cells(const RectC &rect, int zoom, QList<Cell*> &list)
+{
+	QList<Cell*> all;
+	double min[2], max[2];
+
+	rectcBounds(rect, min, max);
+	_cells.Search(min, max, cellCb, &all);
+	select(rect, zoom, all, list);
+
+	_lock.lock();
+
+	for (int i = 0; i < list.size(); i++)
+		list.at(i)->_refs++;
+
+	for (int i = 0; i < list.size(); i++) {
+		Cell *cell = list.at(i);
+
+		while (cell->_loading)
+			_cond.wait(&_lock);
+
+		/* The cell is loaded without holding the lock, other tiles waiting
+		   for the same cell are blocked by the _loading flag */
+		if (!cell->_data) {
+			cell->_loading = true;
+			_lock.unlock();
+
+			MapData *data = new MapData(cell->_path, cell->_bounds);
+			data->load();
+
+			_lock.lock();
+			cell->_data = data;
+			cell->_loading = false;
+			_loaded.append(cell);
+			_size += cell->_size;
+			_cond.wakeAll();
+		}
+
+		cell->_used = ++_time;
+	}
+
+	_lock.unlock();
+}
+
+void AtlasData::release(const QList<Cell*> &list)
+{
+	_lock.lock();
+
+	for (int i = 0; i < list.size(); i++)
+		list.at(i)->_refs--;
+	trim();
+
+	_lock.unlock();
+}
+
+bool AtlasData::lessUsed(const Cell *c1, const Cell *c2)
+{
+	return c1->_used < c2->_used;
+}
+
+void AtlasData::trim()
+{
+	if (_size <= CACHE_SIZE)
+		return;
+
+	std::sort(_loaded.begin(), _loaded.end(), lessUsed);
+
+	for (int i = 0; i < _loaded.size() && _size > CACHE_SIZE; ) {
+		Cell *cell = _loaded.at(i);
+
+		if (cell->_refs) {
+			i++;
+			continue;
+		}
+
+		delete cell->_data;
+		cell->_data = 0;
+		_size -= cell->_size;
+		_loaded.removeAt(i);
+	}
+}
+
+void AtlasData::clear()
+{
+	_lock.lock();
+
+	for (int i = 0; i < _loaded.size(); i++) {
+		Cell *cell = _loaded.at(i);
+		delete cell->_data;
+		cell->_data = 0;
+	}
+	_loaded.clear();
+	_size = 0;
+
+	_lock.unlock();
+}
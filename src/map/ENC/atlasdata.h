@@ -0,0 +1,81 @@
+#ifndef ENC_ATLASDATA_H
+#define ENC_ATLASDATA_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include "mapdata.h"
+
+namespace ENC {
+
+/* ENC exchange set data. The cells are indexed by their coverage bounds and
+   intended usage (navigational purpose) band, only the cells required for
+   rendering are loaded. The band is chosen per area, every area is rendered
+   using the most detailed cells suitable for the zoom that cover it. Cells
+   are pinned while in use by a tile and the least recently used cells are
+   unloaded when the loaded cells size exceeds the cache size. */
+class AtlasData
+{
+public:
+	class Cell {
+	public:
+		Cell(const QString &path, const RectC &bounds, int band, qint64 size)
+		  : _path(path), _bounds(bounds), _band(band), _size(size), _data(0),
+		  _refs(0), _used(0), _loading(false) {}
+		~Cell() {delete _data;}
+
+		const RectC &bounds() const {return _bounds;}
+		int band() const {return _band;}
+		const MapData *data() const {return _data;}
+
+	private:
+		friend class AtlasData;
+
+		QString _path;
+		RectC _bounds;
+		int _band;
+		qint64 _size;
+		MapData *_data;
+		int _refs;
+		quint64 _used;
+		bool _loading;
+	};
+
+	AtlasData() : _bands(0), _size(0), _time(0) {}
+	~AtlasData();
+
+	void addCell(const QString &path, const RectC &bounds);
+	bool isEmpty() const {return _list.isEmpty();}
+
+	const RectC &bounds() const {return _bounds;}
+	Range zooms() const;
+	Range zooms(int zoom) const {return bandZooms(band(zoom));}
+
+	void cells(const RectC &rect, int zoom, QList<Cell*> &list);
+	void release(const QList<Cell*> &list);
+	void clear();
+
+private:
+	typedef RTree<Cell*, double, 2> CellTree;
+
+	static Range bandZooms(int band);
+	static int zoomBand(int zoom);
+	static void select(const RectC &rect, int zoom, QList<Cell*> &cells,
+	  QList<Cell*> &list);
+	static bool lessUsed(const Cell *c1, const Cell *c2);
+	int band(int zoom) const;
+	void trim();
+
+	CellTree _cells;
+	QList<Cell*> _list;
+	QList<Cell*> _loaded;
+	RectC _bounds;
+	quint8 _bands;
+	qint64 _size;
+	quint64 _time;
+	QMutex _lock;
+	QWaitCondition _cond;
+};
+
+}
+
+#endif // ENC_ATLASDATA_H
@@ -66,6 +66,8 @@ public:
 	};
 
 	MapData(const QString &path);
+	MapData(const QString &path, const RectC &bounds)
+	  : _fileName(path), _bounds(bounds) {}
 	~MapData();
 
 	const QString &name() const {return _name;}
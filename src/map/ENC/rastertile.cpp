@@ -241,7 +241,7 @@ void RasterTile::drawTextItems(QPainter *painter,
 }
 
 void RasterTile::processPolygons(const QList<MapData::Poly*> &polygons,
-  QList<TextItem*> &textItems)
+  TextItemGrid &textItems)
 {
 	const Style &s = style();
 
@@ -268,7 +268,7 @@ void RasterTile::processPolygons(const QList<MapData::Poly*> &polygons,
 }
 
 void RasterTile::processPoints(QList<MapData::Point*> &points,
-  QList<TextItem*> &textItems, QList<TextItem*> &lights)
+  TextItemGrid &textItems, QList<TextItem*> &lights)
 {
 	const Style &s = style();
 	PointMap lightsMap, signalsMap;
@@ -295,7 +295,7 @@ void RasterTile::processPoints(QList<MapData::Point*> &points,
 
 		const QString *label = point->label().isEmpty() ? 0 : &(point->label());
 		const QImage *img = style.img().isNull() ? 0 : &style.img();
-		const QFont *fnt = showLabel(img, _data->zooms(), _zoom, point->type())
+		const QFont *fnt = showLabel(img, _zooms, _zoom, point->type())
 		  ? font(style.textFontSize()) : 0;
 		const QColor *color = &style.textColor();
 		const QColor *hColor = style.haloColor().isValid()
@@ -319,7 +319,7 @@ void RasterTile::processPoints(QList<MapData::Point*> &points,
 }
 
 void RasterTile::processLines(const QList<MapData::Line*> &lines,
-  QList<TextItem*> &textItems)
+  TextItemGrid &textItems)
 {
 	const Style &s = style();
 
@@ -344,25 +344,27 @@ void RasterTile::processLines(const QList<MapData::Line*> &lines,
 	}
 }
 
-void RasterTile::fetchData(QList<MapData::Poly*> &polygons,
-  QList<MapData::Line*> &lines, QList<MapData::Point*> &points)
+RectC RasterTile::bounds(int extent) const
 {
-	QPoint ttl(_rect.topLeft());
-
-	QRectF polyRect(ttl, QPointF(ttl.x() + _rect.width(), ttl.y()
-	  + _rect.height()));
-	RectD polyRectD(_transform.img2proj(polyRect.topLeft()),
-	  _transform.img2proj(polyRect.bottomRight()));
-	RectC polyRectC(polyRectD.toRectC(_proj, 20));
-	_data->lines(polyRectC, &lines);
-	_data->polygons(polyRectC, &polygons);
-
-	QRectF pointRect(QPointF(ttl.x() - TEXT_EXTENT, ttl.y() - TEXT_EXTENT),
-	  QPointF(ttl.x() + _rect.width() + TEXT_EXTENT, ttl.y() + _rect.height()
-	  + TEXT_EXTENT));
-	RectD pointRectD(_transform.img2proj(pointRect.topLeft()),
-	  _transform.img2proj(pointRect.bottomRight()));
-	_data->points(pointRectD.toRectC(_proj, 20), &points);
+	QRectF rect(QRectF(_rect).adjusted(-extent, -extent, extent, extent));
+	RectD rectD(_transform.img2proj(rect.topLeft()),
+	  _transform.img2proj(rect.bottomRight()));
+
+	return rectD.toRectC(_proj, 20);
+}
+
+void RasterTile::fetchData(const QList<const MapData*> &data,
+  QList<MapData::Poly*> &polygons, QList<MapData::Line*> &lines,
+  QList<MapData::Point*> &points)
+{
+	RectC polyRectC(bounds(0));
+	RectC pointRectC(bounds(TEXT_EXTENT));
+
+	for (int i = 0; i < data.size(); i++) {
+		data.at(i)->lines(polyRectC, &lines);
+		data.at(i)->polygons(polyRectC, &polygons);
+		data.at(i)->points(pointRectC, &points);
+	}
 }
 
 void RasterTile::render()
@@ -370,12 +372,23 @@ void RasterTile::render()
 	QList<MapData::Line*> lines;
 	QList<MapData::Poly*> polygons;
 	QList<MapData::Point*> points;
-	QList<TextItem*> textItems, lights;
+	QList<TextItem*> lights;
+	TextItemGrid textItems;
+	QList<AtlasData::Cell*> cells;
+	QList<const MapData*> data;
 
 	_pixmap.setDevicePixelRatio(_ratio);
 	_pixmap.fill(Qt::transparent);
 
-	fetchData(polygons, lines, points);
+	/* The atlas cells stay loaded until the tile is rendered */
+	if (_atlas) {
+		_atlas->cells(bounds(TEXT_EXTENT), _zoom, cells);
+		for (int i = 0; i < cells.size(); i++)
+			data.append(cells.at(i)->data());
+	} else
+		data.append(_data);
+
+	fetchData(data, polygons, lines, points);
 
 	processPolygons(polygons, textItems);
 	processPoints(points, textItems, lights);
@@ -391,11 +404,14 @@ void RasterTile::render()
 	drawArrows(&painter, polygons);
 
 	drawTextItems(&painter, lights);
-	drawTextItems(&painter, textItems);
+	drawTextItems(&painter, textItems.items());
 
-	qDeleteAll(textItems);
+	qDeleteAll(textItems.items());
 	qDeleteAll(lights);
 
+	if (_atlas)
+		_atlas->release(cells);
+
 	//painter.setPen(Qt::red);
 	//painter.setBrush(Qt::NoBrush);
 	//painter.drawRect(QRect(_rect.topLeft(), _pixmap.size()));
@@ -5,7 +5,9 @@
 #include "map/projection.h"
 #include "map/transform.h"
 #include "map/textpointitem.h"
+#include "map/textitemgrid.h"
 #include "mapdata.h"
+#include "atlasdata.h"
 
 class TextItem;
 
@@ -16,8 +18,13 @@ class RasterTile
 public:
 	RasterTile(const Projection &proj, const Transform &transform,
 	  const MapData *data, int zoom, const QRect &rect, qreal ratio)
-	  : _proj(proj), _transform(transform), _data(data), _zoom(zoom),
-	  _rect(rect), _ratio(ratio),
+	  : _proj(proj), _transform(transform), _data(data), _atlas(0),
+	  _zoom(zoom), _zooms(data->zooms()), _rect(rect), _ratio(ratio),
+	  _pixmap(rect.width() * ratio, rect.height() * ratio), _valid(false) {}
+	RasterTile(const Projection &proj, const Transform &transform,
+	  AtlasData *atlas, int zoom, const QRect &rect, qreal ratio)
+	  : _proj(proj), _transform(transform), _data(0), _atlas(atlas),
+	  _zoom(zoom), _zooms(atlas->zooms(zoom)), _rect(rect), _ratio(ratio),
 	  _pixmap(rect.width() * ratio, rect.height() * ratio), _valid(false) {}
 
 	int zoom() const {return _zoom;}
@@ -28,7 +35,9 @@ public:
 	void render();
 
 private:
-	void fetchData(QList<MapData::Poly*> &polygons, QList<MapData::Line*> &lines,
+	RectC bounds(int extent) const;
+	void fetchData(const QList<const MapData*> &data,
+	  QList<MapData::Poly*> &polygons, QList<MapData::Line*> &lines,
 	  QList<MapData::Point*> &points);
 	QPointF ll2xy(const Coordinates &c) const
 	  {return _transform.proj2img(_proj.ll2xy(c));}
@@ -36,11 +45,11 @@ private:
 	QPolygonF polyline(const QVector<Coordinates> &path) const;
 	QPolygonF tsslptArrow(const Coordinates &c, qreal angle) const;
 	void processPoints(QList<MapData::Point *> &points,
-	  QList<TextItem*> &textItems, QList<TextItem *> &lights);
+	  TextItemGrid &textItems, QList<TextItem *> &lights);
 	void processLines(const QList<MapData::Line *> &lines,
-	  QList<TextItem*> &textItems);
+	  TextItemGrid &textItems);
 	void processPolygons(const QList<MapData::Poly *> &polygons,
-	  QList<TextItem*> &textItems);
+	  TextItemGrid &textItems);
 	void drawBitmapPath(QPainter *painter, const QImage &img,
 	  const Polygon &polygon);
 	void drawArrows(QPainter *painter, const QList<MapData::Poly*> &polygons);
@@ -51,7 +60,9 @@ private:
 	Projection _proj;
 	Transform _transform;
 	const MapData *_data;
+	AtlasData *_atlas;
 	int _zoom;
+	Range _zooms;
 	QRect _rect;
 	qreal _ratio;
 	QPixmap _pixmap;
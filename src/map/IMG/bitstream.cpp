@@ -36,7 +36,7 @@ bool BitStream4F::flush()
 		return false;
 
 	_length = 0;
-	_used = 32;
+	_used = BITS;
 	_unused = 0;
 
 	return true;
@@ -45,30 +45,31 @@ bool BitStream4F::flush()
 bool BitStream4F::read(quint32 bits, quint32 &val)
 {
 	if (bits <= available()) {
-		val = bits ? (_data << _used) >> (32U - bits) : 0;
+		val = bits ? (quint32)((_data << _used) >> (BITS - bits)) : 0;
 		_used += bits;
 		return true;
 	}
 
 	Q_ASSERT(_length && !_unused);
-	quint32 old = (_used < 32U) ? (_data << _used) >> (32U - bits) : 0;
-	quint32 bytes = qMin(_length, 4U);
+	quint32 old = (_used < BITS)
+	  ? (quint32)((_data << _used) >> (BITS - bits)) : 0;
+	quint32 bytes = qMin(_length, 8U);
 
-	if (!_file.readVUInt32SW(_hdl, bytes, _data))
+	if (!_file.readVUIntSW(_hdl, bytes, _data))
 		return false;
 
-	_used -= 32U - bits;
+	_used -= BITS - bits;
 	_length -= bytes;
-	_unused = (4U - bytes) << 3;
+	_unused = (8U - bytes) << 3;
 	_data <<= _unused;
 
-	val = _data >> (32 - _used) | old;
+	val = (quint32)(_data >> (BITS - _used)) | old;
 
 	return true;
 }
 
 BitStream4R::BitStream4R(const SubFile &file, SubFile::Handle &hdl,
-  quint32 length) : BitStream4(file, hdl, length)
+  quint32 length) : BitStream4<quint32>(file, hdl, length)
 {
 	_file.seek(_hdl, _file.pos(_hdl) - 4);
 }
@@ -23,34 +23,39 @@ private:
 	quint8 _data;
 };
 
+/* T is the type of the bit buffer, the forward stream is refilled with up to
+   64 bits at once, the reverse stream works with 32 bit words. */
+template<typename T>
 class BitStream4 {
 public:
 	BitStream4(const SubFile &file, SubFile::Handle &hdl, quint32 length)
-	  : _file(file), _hdl(hdl), _length(length), _used(32), _unused(0),
+	  : _file(file), _hdl(hdl), _length(length), _used(BITS), _unused(0),
 	  _data(0) {}
 
 	quint64 bitsAvailable() const
 	  {return ((quint64)_length << 3) + available();}
 
 protected:
-	quint32 available() const {return 32U - (_used + _unused);}
+	static const quint32 BITS = sizeof(T) * 8;
+
+	quint32 available() const {return BITS - (_used + _unused);}
 
 	const SubFile &_file;
 	SubFile::Handle &_hdl;
 	quint32 _length, _used, _unused;
-	quint32 _data;
+	T _data;
 };
 
-class BitStream4F : public BitStream4 {
+class BitStream4F : public BitStream4<quint64> {
 public:
 	BitStream4F(const SubFile &file, SubFile::Handle &hdl, quint32 length)
-	  : BitStream4(file, hdl, length) {}
+	  : BitStream4<quint64>(file, hdl, length) {}
 
 	bool read(quint32 bits, quint32 &val);
 	bool flush();
 };
 
-class BitStream4R : public BitStream4 {
+class BitStream4R : public BitStream4<quint32> {
 public:
 	struct State {
 		quint32 pos;
@@ -4,6 +4,8 @@
 using namespace Garmin;
 using namespace IMG;
 
+#define LOOKUP_BITS 10
+
 static inline quint32 readVUint32(const quint8 *buffer, quint32 bytes)
 {
 	quint32 val = 0;
@@ -33,10 +35,46 @@ bool HuffmanTable::load(const RGNFile *rgn, SubFile::Handle &rgnHdl)
 	_aclTable = _bsrchTable + _bsrchEntryBytes * _bsrchEntries;
 	_huffmanTable = _aclTable + (_aclEntryBytes << _aclBits);
 
-	return (_symBits <= 32 && _symbolBits <= 32);
+	if (!(_symBits <= 32 && _symbolBits <= 32))
+		return false;
+
+	if (_huffmanTable <= (const quint8*)_buffer.constData() + _buffer.size())
+		createLookupTable();
+
+	return true;
+}
+
+void HuffmanTable::createLookupTable()
+{
+	if (!_aclBits && !_bsrchEntries)
+		return;
+
+	_lookupBits = qMin(_symBits, (quint8)LOOKUP_BITS);
+	if (!_lookupBits)
+		return;
+
+	_lookup.resize(1U << _lookupBits);
+
+	for (int i = 0; i < _lookup.size(); i++) {
+		quint32 first = (quint32)i << (32 - _lookupBits);
+		quint32 last = first | (0xFFFFFFFFU >> _lookupBits);
+		quint8 firstSize, lastSize;
+		Entry &e = _lookup[i];
+
+		/* The code is short enough when all the data with the given prefix
+		   decode to the same symbol of a size within the prefix */
+		e.symbol = decode(first, firstSize);
+		if (firstSize <= _lookupBits && decode(last, lastSize) == e.symbol
+		  && lastSize == firstSize)
+			e.size = firstSize;
+		else {
+			e.symbol = 0;
+			e.size = 0;
+		}
+	}
 }
 
-quint32 HuffmanTable::symbol(quint32 data, quint8 &size) const
+quint32 HuffmanTable::decode(quint32 data, quint8 &size) const
 {
 	quint32 lo, hi;
 	const quint8 *tp;
@@ -51,7 +89,7 @@ quint32 HuffmanTable::symbol(quint32 data, quint8 &size) const
 
 		if (*tp & 1) {
 			size = *tp >> 1;
-			return readVUint32(tp + 1, _symbolBytes);;
+			return readVUint32(tp + 1, _symbolBytes);
 		}
 
 		lo = *tp >> 1;
@@ -1,6 +1,7 @@
 #ifndef IMG_HUFFMANTABLE_H
 #define IMG_HUFFMANTABLE_H
 
+#include <QVector>
 #include "huffmanbuffer.h"
 
 namespace IMG {
@@ -9,22 +10,46 @@ class RGNFile;
 
 class HuffmanTable {
 public:
-	HuffmanTable(quint8 id) : _buffer(id) {}
+	HuffmanTable(quint8 id) : _buffer(id), _lookupBits(0) {}
 
 	bool load(const RGNFile *rgn, SubFile::Handle &rgnHdl);
 
-	quint32 symbol(quint32 data, quint8 &size) const;
+	quint32 symbol(quint32 data, quint8 &size) const
+	{
+		if (_lookupBits) {
+			const Entry &e = _lookup.at(data >> (32 - _lookupBits));
+			if (e.size) {
+				size = e.size;
+				return e.symbol;
+			}
+		}
+
+		return decode(data, size);
+	}
 	quint8 id() const {return _buffer.id();}
 
 	quint8 symBits() const {return _symBits;}
 	quint8 symbolBits() const {return _symbolBits;}
 
 private:
+	struct Entry {
+		quint32 symbol;
+		quint8 size;
+	};
+
+	quint32 decode(quint32 data, quint8 &size) const;
+	void createLookupTable();
+
 	HuffmanBuffer _buffer;
 	const quint8 *_aclTable, *_bsrchTable, *_huffmanTable;
 	quint8 _aclBits, _aclEntryBytes, _symBits, _symBytes, _indexBytes,
 	  _bsrchEntryBytes, _bsrchEntries, _symbolBits, _symbolBytes;
 	bool _huffman;
+
+	/* Direct lookup table of all the symbols with codes not longer than
+	   _lookupBits, longer codes are decoded using the ACL/bsrch tables. */
+	QVector<Entry> _lookup;
+	quint8 _lookupBits;
 };
 
 }
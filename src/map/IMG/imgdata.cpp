@@ -161,7 +161,8 @@ bool IMGData::createTileTree(const TileMap &tileMap)
 	return (_tileTree.Count() > 0);
 }
 
-IMGData::IMGData(const QString &fileName) : MapData(fileName)
+IMGData::IMGData(const QString &fileName)
+  : MapData(fileName), _file(fileName), _map(0), _mapSize(0)
 {
 	QFile file(fileName);
 	TileMap tileMap;
@@ -218,3 +219,28 @@ bool IMGData::readBlock(QFile &file, int blockNum, char *data) const
 
 	return true;
 }
+
+void IMGData::load()
+{
+	/* Map the whole IMG file once, all the sub-file handles then read the
+	   blocks directly from the mapping. XORed images can not be read
+	   in-place and fall back to the block reads. */
+	if (!_key && _file.open(QIODevice::ReadOnly)) {
+		_map = _file.map(0, _file.size());
+		if (_map)
+			_mapSize = _file.size();
+		else
+			_file.close();
+	}
+
+	MapData::load();
+}
+
+void IMGData::clear()
+{
+	MapData::clear();
+
+	_file.close();
+	_map = 0;
+	_mapSize = 0;
+}
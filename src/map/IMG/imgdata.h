@@ -1,10 +1,9 @@
 #ifndef IMG_IMGDATA_H
 #define IMG_IMGDATA_H
 
+#include <QFile>
 #include "mapdata.h"
 
-class QFile;
-
 namespace IMG {
 
 class IMGData : public MapData
@@ -15,6 +14,12 @@ public:
 	unsigned blockBits() const {return _blockBits;}
 	bool readBlock(QFile &file, int blockNum, char *data) const;
 
+	const uchar *map() const {return _map;}
+	quint64 mapSize() const {return _mapSize;}
+
+	void load();
+	void clear();
+
 private:
 	typedef QMap<QByteArray, VectorTile*> TileMap;
 
@@ -27,6 +32,10 @@ private:
 
 	quint8 _key;
 	unsigned _blockBits;
+
+	QFile _file;
+	uchar *_map;
+	quint64 _mapSize;
 };
 
 }
@@ -129,6 +129,10 @@ bool LBLFile::load(Handle &hdl, const RGNFile *rgn, Handle &rgnHdl)
 
 void LBLFile::clear()
 {
+	_labelsLock.lock();
+	_labels.clear();
+	_labelsLock.unlock();
+
 	delete _huffmanText;
 	delete[] _table;
 	delete[] _rasters;
@@ -306,6 +310,29 @@ Label LBLFile::labelHuffman(Handle &hdl, const SubFile *file, Handle &fileHdl,
 
 Label LBLFile::label(Handle &hdl, quint32 offset, bool poi, bool capitalize,
   bool convert) const
+{
+	quint64 k(key(offset, poi, capitalize, convert));
+
+	_labelsLock.lock();
+	Label *cached = _labels.object(k);
+	if (cached) {
+		Label label(*cached);
+		_labelsLock.unlock();
+		return label;
+	}
+	_labelsLock.unlock();
+
+	Label label(decode(hdl, offset, poi, capitalize, convert));
+
+	_labelsLock.lock();
+	_labels.insert(k, new Label(label));
+	_labelsLock.unlock();
+
+	return label;
+}
+
+Label LBLFile::decode(Handle &hdl, quint32 offset, bool poi, bool capitalize,
+  bool convert) const
 {
 	quint32 labelOffset;
 	if (poi) {
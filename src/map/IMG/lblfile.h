@@ -2,11 +2,15 @@
 #define IMG_LBLFILE_H
 
 #include <QPixmap>
+#include <QCache>
+#include <QMutex>
 #include "common/textcodec.h"
 #include "section.h"
 #include "subfile.h"
 #include "label.h"
 
+#define LABEL_CACHE_SIZE 8192 /* labels */
+
 namespace IMG {
 
 class HuffmanText;
@@ -17,13 +21,14 @@ class LBLFile : public SubFile
 public:
 	LBLFile(const IMGData *img)
 	  : SubFile(img), _huffmanText(0), _table(0), _rasters(0), _imgIdSize(0),
-	  _poiShift(0), _shift(0), _encoding(0) {}
+	  _poiShift(0), _shift(0), _encoding(0), _labels(LABEL_CACHE_SIZE) {}
 	LBLFile(const QString *path)
 	  : SubFile(path), _huffmanText(0), _table(0), _rasters(0), _imgIdSize(0),
-	  _poiShift(0), _shift(0), _encoding(0) {}
+	  _poiShift(0), _shift(0), _encoding(0), _labels(LABEL_CACHE_SIZE) {}
 	LBLFile(const SubFile *gmp, quint32 offset)
 	  : SubFile(gmp, offset), _huffmanText(0), _table(0), _rasters(0),
-	  _imgIdSize(0), _poiShift(0), _shift(0), _encoding(0) {}
+	  _imgIdSize(0), _poiShift(0), _shift(0), _encoding(0),
+	  _labels(LABEL_CACHE_SIZE) {}
 	~LBLFile();
 
 	bool load(Handle &hdl, const RGNFile *rgn, Handle &rgnHdl);
@@ -43,6 +48,14 @@ private:
 		quint32 size;
 	};
 
+	static quint64 key(quint32 offset, bool poi, bool capitalize, bool convert)
+	{
+		return (quint64)offset | ((quint64)poi << 32)
+		  | ((quint64)capitalize << 33) | ((quint64)convert << 34);
+	}
+
+	Label decode(Handle &hdl, quint32 offset, bool poi, bool capitalize,
+	  bool convert) const;
 	Label str2label(const QVector<quint8> &str, bool capitalize,
 	  bool convert) const;
 	Label label6b(const SubFile *file, Handle &fileHdl, quint32 size,
@@ -64,6 +77,11 @@ private:
 	quint8 _poiShift;
 	quint8 _shift;
 	quint8 _encoding;
+
+	/* The same labels are referenced from many subdivisions and zoom levels,
+	   the cached labels are decoded only once and share the strings. */
+	mutable QCache<quint64, Label> _labels;
+	mutable QMutex _labelsLock;
 };
 
 }
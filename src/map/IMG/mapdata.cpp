@@ -1,5 +1,7 @@
+#include <climits>
 #include <QFileInfo>
 #include "common/programpaths.h"
+#include "common/garmin.h"
 #include "vectortile.h"
 #include "style.h"
 #include "mapdata.h"
@@ -7,20 +9,150 @@
 
 using namespace IMG;
 
-#define CACHED_SUBDIVS_COUNT 2048 // ~32MB for both caches together
+/* Share of the polygons/lines cache in the map data cache budget (the rest
+   is used for the points) */
+#define POLY_CACHE_RATIO 0.75
+
+static inline qint32 toUnits(double deg)
+{
+	/* +180 deg is out of the qint32 range, clamp it to the nearest value
+	   instead of wrapping it to -180 deg */
+	qint64 units = qRound64((deg / 180.0) * (double)(1U<<31));
+	return (qint32)qBound((qint64)INT_MIN, units, (qint64)INT_MAX);
+}
+
+static void writeVInt(QByteArray &data, qint32 val)
+{
+	quint32 z = ((quint32)val << 1) ^ (quint32)(val >> 31);
+
+	while (z >= 0x80) {
+		data.append((char)(z | 0x80));
+		z >>= 7;
+	}
+	data.append((char)z);
+}
+
+static inline const uchar *readVInt(const uchar *p, qint32 &val)
+{
+	quint32 z = 0;
+	int shift = 0;
+	uchar b;
+
+	do {
+		b = *p++;
+		z |= (quint32)(b & 0x7F) << shift;
+		shift += 7;
+	} while (b & 0x80);
+
+	val = (qint32)(z >> 1) ^ -(qint32)(z & 1);
+
+	return p;
+}
+
+MapData::Polys::Polys(const QList<Poly> &polygons, const QList<Poly> &lines)
+{
+	encode(polygons, _polygons);
+	encode(lines, _lines);
+	_points.squeeze();
+}
+
+void MapData::Polys::encode(const QList<Poly> &src, QVector<Feature> &dst)
+{
+	dst.resize(src.size());
+
+	for (int i = 0; i < src.size(); i++) {
+		const Poly &poly = src.at(i);
+		Feature &f = dst[i];
+		quint32 px = 0, py = 0;
+
+		f.label = poly.label;
+		f.raster = poly.raster;
+		f.type = poly.type;
+		f.boundingRect = poly.boundingRect;
+		f.offset = _points.size();
+		f.size = poly.points.size();
+
+		/* The differences are computed in unsigned arithmetic, the overflows
+		   wrap around the same way when decoding */
+		for (int j = 0; j < poly.points.size(); j++) {
+			const QPointF &p = poly.points.at(j);
+			quint32 x = (quint32)toUnits(p.x());
+			quint32 y = (quint32)toUnits(p.y());
+			writeVInt(_points, (qint32)(x - px));
+			writeVInt(_points, (qint32)(y - py));
+			px = x;
+			py = y;
+		}
+	}
+}
+
+void MapData::Polys::decode(const QVector<Feature> &src, const RectC &rect,
+  QList<Poly> *dst) const
+{
+	const uchar *data = (const uchar*)_points.constData();
+
+	for (int i = 0; i < src.size(); i++) {
+		const Feature &f = src.at(i);
+		if (!rect.intersects(f.boundingRect))
+			continue;
+
+		dst->append(Poly());
+		Poly &poly = dst->last();
+		poly.label = f.label;
+		poly.raster = f.raster;
+		poly.type = f.type;
+		poly.boundingRect = f.boundingRect;
+		poly.points.resize(f.size);
+
+		const uchar *p = data + f.offset;
+		quint32 x = 0, y = 0;
+		for (int j = 0; j < f.size; j++) {
+			qint32 dx, dy;
+			p = readVInt(p, dx);
+			p = readVInt(p, dy);
+			x += (quint32)dx;
+			y += (quint32)dy;
+			poly.points[j] = QPointF(Garmin::toWGS32((qint32)x),
+			  Garmin::toWGS32((qint32)y));
+		}
+	}
+}
+
+int MapData::cost(const QList<Point> &points)
+{
+	int size = sizeof(points) + points.size() * (sizeof(Point) + sizeof(void*));
+
+	for (int i = 0; i < points.size(); i++)
+		size += points.at(i).label.text().size() * sizeof(QChar);
+
+	return size;
+}
+
+int MapData::Polys::cost() const
+{
+	int size = sizeof(*this) + _points.capacity() + (_polygons.capacity()
+	  + _lines.capacity()) * sizeof(Feature);
+
+	for (int i = 0; i < _polygons.size(); i++)
+		size += _polygons.at(i).label.text().size() * sizeof(QChar);
+	for (int i = 0; i < _lines.size(); i++)
+		size += _lines.at(i).label.text().size() * sizeof(QChar);
+
+	return size;
+}
 
 bool MapData::polyCb(VectorTile *tile, void *context)
 {
 	PolyCTX *ctx = (PolyCTX*)context;
 	tile->polys(ctx->rect, ctx->zoom, ctx->polygons, ctx->lines,
-	  ctx->polyCache, ctx->lock);
+	  ctx->polyCache);
 	return true;
 }
 
 bool MapData::pointCb(VectorTile *tile, void *context)
 {
 	PointCTX *ctx = (PointCTX*)context;
-	tile->points(ctx->rect, ctx->zoom, ctx->points, ctx->pointCache, ctx->lock);
+	tile->points(ctx->rect, ctx->zoom, ctx->points, ctx->pointCache);
 	return true;
 }
 
@@ -28,12 +160,12 @@ bool MapData::pointCb(VectorTile *tile, void *context)
 MapData::MapData(const QString &fileName)
   : _fileName(fileName), _typ(0), _style(0), _valid(false)
 {
-	_polyCache.setMaxCost(CACHED_SUBDIVS_COUNT);
-	_pointCache.setMaxCost(CACHED_SUBDIVS_COUNT);
 }
 
 MapData::~MapData()
 {
+	CacheBudget::detach(this);
+
 	TileTree::Iterator it;
 	for (_tileTree.GetFirst(it); !_tileTree.IsNull(it); _tileTree.GetNext(it))
 		delete _tileTree.GetAt(it);
@@ -45,7 +177,7 @@ MapData::~MapData()
 void MapData::polys(const RectC &rect, int bits, QList<Poly> *polygons,
   QList<Poly> *lines)
 {
-	PolyCTX ctx(rect, zoom(bits), polygons, lines, &_polyCache, &_lock);
+	PolyCTX ctx(rect, zoom(bits), polygons, lines, &_polyCache);
 	double min[2], max[2];
 
 	min[0] = rect.left();
@@ -54,11 +186,13 @@ void MapData::polys(const RectC &rect, int bits, QList<Poly> *polygons,
 	max[1] = rect.top();
 
 	_tileTree.Search(min, max, polyCb, &ctx);
+
+	CacheBudget::use(this);
 }
 
 void MapData::points(const RectC &rect, int bits, QList<Point> *points)
 {
-	PointCTX ctx(rect, zoom(bits), points, &_pointCache, &_lock);
+	PointCTX ctx(rect, zoom(bits), points, &_pointCache);
 	double min[2], max[2];
 
 	min[0] = rect.left();
@@ -67,6 +201,8 @@ void MapData::points(const RectC &rect, int bits, QList<Point> *points)
 	max[1] = rect.top();
 
 	_tileTree.Search(min, max, pointCb, &ctx);
+
+	CacheBudget::use(this);
 }
 
 void MapData::load()
@@ -83,10 +219,14 @@ void MapData::load()
 		} else
 			_style = new Style();
 	}
+
+	CacheBudget::attach(this);
 }
 
 void MapData::clear()
 {
+	CacheBudget::detach(this);
+
 	TileTree::Iterator it;
 	for (_tileTree.GetFirst(it); !_tileTree.IsNull(it); _tileTree.GetNext(it))
 		_tileTree.GetAt(it)->clear();
@@ -98,6 +238,31 @@ void MapData::clear()
 	_pointCache.clear();
 }
 
+void MapData::setCacheSize(int size)
+{
+	int polySize = (int)(size * POLY_CACHE_RATIO);
+
+	_polyCache.setMaxCost(polySize);
+	_pointCache.setMaxCost(size - polySize);
+}
+
+qint64 MapData::cacheSize() const
+{
+	return _polyCache.totalCost() + _pointCache.totalCost();
+}
+
+void MapData::trimCache(qint64 size)
+{
+	qint64 polyCost = _polyCache.totalCost();
+	qint64 total = polyCost + _pointCache.totalCost();
+
+	if (total > size) {
+		qint64 polySize = (size * polyCost) / total;
+		_polyCache.trim(polySize);
+		_pointCache.trim(size - polySize);
+	}
+}
+
 void MapData::computeZooms()
 {
 	TileTree::Iterator it;
@@ -126,15 +291,17 @@ void MapData::computeZooms()
 	  : qMax(0, _zooms.first().bits() - 2), 28);
 }
 
-const Zoom &MapData::zoom(int bits) const
+static bool bitsLessThan(int bits, const Zoom &zoom)
 {
-	int id = 0;
+	return bits < zoom.bits();
+}
 
-	for (int i = 1; i < _zooms.size(); i++) {
-		if (_zooms.at(i).bits() > bits)
-			break;
-		id++;
-	}
+const Zoom &MapData::zoom(int bits) const
+{
+	/* The zooms are sorted by bits, use the last zoom with bits <= the
+	   requested bits or the first zoom if there is no such zoom */
+	QList<Zoom>::const_iterator it = std::upper_bound(_zooms.constBegin(),
+	  _zooms.constEnd(), bits, bitsLessThan);
 
-	return _zooms.at(id);
+	return (it == _zooms.constBegin()) ? *it : *(it - 1);
 }
@@ -3,6 +3,7 @@
 
 #include <QList>
 #include <QPointF>
+#include <QByteArray>
 #include <QCache>
 #include <QMutex>
 #include <QDebug>
@@ -10,6 +11,8 @@
 #include "common/rtree.h"
 #include "common/range.h"
 #include "common/hash.h"
+#include "map/cachebudget.h"
+#include "map/shardedcache.h"
 #include "label.h"
 #include "raster.h"
 #include "zoom.h"
@@ -21,7 +24,7 @@ class SubDiv;
 class SubFile;
 class VectorTile;
 
-class MapData
+class MapData : public CacheBudget::Client
 {
 public:
 	struct Poly {
@@ -63,8 +66,12 @@ public:
 	  QList<Poly> *lines);
 	void points(const RectC &rect, int bits, QList<Point> *points);
 
-	void load();
-	void clear();
+	virtual void load();
+	virtual void clear();
+
+	void setCacheSize(int size);
+	qint64 cacheSize() const;
+	void trimCache(qint64 size);
 
 	const QString &fileName() const {return _fileName;}
 
@@ -89,56 +96,79 @@ protected:
 	QString _errorString;
 
 private:
-	struct Polys {
-		Polys() {}
-		Polys(const QList<Poly> &polygons, const QList<Poly> &lines)
-			: polygons(polygons), lines(lines) {}
-
-		QList<Poly> polygons;
-		QList<Poly> lines;
+	/* Compact representation of the subdivision polygons/lines used in the
+	   cache. The points of all the features are stored delta-encoded
+	   in Garmin units (zigzag varints) in a single array and only the features
+	   that intersect the requested rect are decoded back to Poly objects. */
+	class Polys
+	{
+	public:
+		Polys(const QList<Poly> &polygons, const QList<Poly> &lines);
+
+		void polygons(const RectC &rect, QList<Poly> *list) const
+		  {decode(_polygons, rect, list);}
+		void lines(const RectC &rect, QList<Poly> *list) const
+		  {decode(_lines, rect, list);}
+
+		int cost() const;
+
+	private:
+		struct Feature {
+			Label label;
+			Raster raster;
+			quint32 type;
+			RectC boundingRect;
+			int offset;
+			int size;
+		};
+
+		void encode(const QList<Poly> &src, QVector<Feature> &dst);
+		void decode(const QVector<Feature> &src, const RectC &rect,
+		  QList<Poly> *dst) const;
+
+		QVector<Feature> _polygons, _lines;
+		QByteArray _points;
 	};
 
-	typedef QCache<const SubDiv*, Polys> PolyCache;
-	typedef QCache<const SubDiv*, QList<Point> > PointCache;
+	typedef ShardedCache<const SubDiv*, Polys> PolyCache;
+	typedef ShardedCache<const SubDiv*, QList<Point> > PointCache;
 
 	struct PolyCTX
 	{
 		PolyCTX(const RectC &rect, const Zoom &zoom,
 		  QList<MapData::Poly> *polygons, QList<MapData::Poly> *lines,
-		  PolyCache *polyCache, QMutex *lock)
+		  PolyCache *polyCache)
 		  : rect(rect), zoom(zoom), polygons(polygons), lines(lines),
-		  polyCache(polyCache), lock(lock) {}
+		  polyCache(polyCache) {}
 
 		const RectC &rect;
 		const Zoom &zoom;
 		QList<MapData::Poly> *polygons;
 		QList<MapData::Poly> *lines;
 		PolyCache *polyCache;
-		QMutex *lock;
 	};
 
 	struct PointCTX
 	{
 		PointCTX(const RectC &rect, const Zoom &zoom,
-		  QList<MapData::Point> *points, PointCache *pointCache, QMutex *lock)
-		  : rect(rect), zoom(zoom), points(points), pointCache(pointCache),
-		  lock(lock) {}
+		  QList<MapData::Point> *points, PointCache *pointCache)
+		  : rect(rect), zoom(zoom), points(points), pointCache(pointCache) {}
 
 		const RectC &rect;
 		const Zoom &zoom;
 		QList<MapData::Point> *points;
 		PointCache *pointCache;
-		QMutex *lock;
 	};
 
 	const Zoom &zoom(int bits) const;
 
+	static int cost(const QList<Point> &points);
+
 	static bool polyCb(VectorTile *tile, void *context);
 	static bool pointCb(VectorTile *tile, void *context);
 
 	PolyCache _polyCache;
 	PointCache _pointCache;
-	QMutex _lock;
 
 	friend class VectorTile;
 };
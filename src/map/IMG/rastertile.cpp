@@ -14,6 +14,7 @@ using namespace IMG;
 
 #define TEXT_EXTENT 160
 #define ICON_PADDING 2
+#define MAX_SHIELD_CANDIDATES 8
 
 #define AREA(rect) \
 	(rect.size().width() * rect.size().height())
@@ -251,23 +252,38 @@ void RasterTile::drawTextItems(QPainter *painter,
 		textItems.at(i)->paint(painter);
 }
 
-static void removeDuplicitLabel(QList<TextItem *> &labels, const QString &text,
-  const QRectF &tileRect)
+class ShieldCandidate
 {
-	for (int i = 0; i < labels.size(); i++) {
-		TextItem *item = labels.at(i);
-		if (tileRect.contains(item->boundingRect()) && *(item->text()) == text) {
-			labels.removeAt(i);
-			delete item;
-			return;
-		}
-	}
-}
+public:
+	ShieldCandidate() : _dist(0) {}
+	ShieldCandidate(const QPointF &pos, const QPointF &center)
+	  : _pos(pos), _dist(QPointF::dotProduct(pos - center, pos - center)) {}
+
+	const QPointF &pos() const {return _pos;}
+	bool operator<(const ShieldCandidate &other) const
+	  {return _dist < other._dist;}
+
+private:
+	QPointF _pos;
+	qreal _dist;
+};
+
+struct ShieldPath
+{
+	ShieldPath() : shield(0) {}
+
+	const Shield *shield;
+	QRectF bounds;
+	QVector<QPointF> points;
+};
 
 void RasterTile::processPolygons(const QList<MapData::Poly> &polygons,
-  QList<TextItem*> &textItems)
+  TextItemGrid &textItems)
 {
+	/* Only the first label of a given text may lie entirely within the tile,
+	   all the other labels must cross the tile boundary. */
 	QSet<QString> set;
+	QHash<QString, TextItem*> inside;
 	QList<TextItem *> labels;
 
 	for (int i = 0; i < polygons.size(); i++) {
@@ -288,21 +304,29 @@ void RasterTile::processPolygons(const QList<MapData::Poly> &polygons,
 			  && !item->collides(labels)
 			  && !(exists && _rect.contains(item->boundingRect().toRect()))
 			  && rectNearPolygon(poly.points, item->boundingRect())) {
-				if (exists)
-					removeDuplicitLabel(labels, poly.label.text(), _rect);
-				else
+				if (exists) {
+					TextItem *dup = inside.take(poly.label.text());
+					if (dup) {
+						labels.removeOne(dup);
+						delete dup;
+					}
+				} else {
 					set.insert(poly.label.text());
+					if (QRectF(_rect).contains(item->boundingRect()))
+						inside.insert(poly.label.text(), item);
+				}
 				labels.append(item);
 			} else
 				delete item;
 		}
 	}
 
-	textItems.append(labels);
+	for (int i = 0; i < labels.size(); i++)
+		textItems.append(labels.at(i));
 }
 
 void RasterTile::processLines(QList<MapData::Poly> &lines,
-  QList<TextItem*> &textItems)
+  TextItemGrid &textItems)
 {
 	std::stable_sort(lines.begin(), lines.end());
 
@@ -312,7 +336,7 @@ void RasterTile::processLines(QList<MapData::Poly> &lines,
 }
 
 void RasterTile::processStreetNames(const QList<MapData::Poly> &lines,
-  QList<TextItem*> &textItems)
+  TextItemGrid &textItems)
 {
 	for (int i = 0; i < lines.size(); i++) {
 		const MapData::Poly &poly = lines.at(i);
@@ -339,15 +363,17 @@ void RasterTile::processStreetNames(const QList<MapData::Poly> &lines,
 }
 
 void RasterTile::processShields(const QList<MapData::Poly> &lines,
-  QList<TextItem*> &textItems)
+  TextItemGrid &textItems)
 {
 	for (int type = FIRST_SHIELD; type <= LAST_SHIELD; type++) {
 		if (minShieldZoom(static_cast<Shield::Type>(type)) > _zoom)
 			continue;
 
-		QHash<Shield, QPolygonF> shields;
-		QHash<Shield, const Shield*> sp;
+		QHash<Shield, ShieldPath> shields;
 
+		/* Only the road vertices inside the tile are shield position
+		   candidates, a shield placed outside the tile can never fit into
+		   it. */
 		for (int i = 0; i < lines.size(); i++) {
 			const MapData::Poly &poly = lines.at(i);
 			const Shield &shield = poly.label.shield();
@@ -355,43 +381,45 @@ void RasterTile::processShields(const QList<MapData::Poly> &lines,
 			  || !Style::isMajorRoad(poly.type))
 				continue;
 
-			QPolygonF &p = shields[shield];
+			ShieldPath &sp = shields[shield];
+			sp.shield = &shield;
+			sp.bounds |= poly.points.boundingRect();
 			for (int j = 0; j < poly.points.size(); j++)
-				p.append(poly.points.at(j));
-
-			sp.insert(shield, &shield);
+				if (_rect.contains(poly.points.at(j).toPoint()))
+					sp.points.append(poly.points.at(j));
 		}
 
-		for (QHash<Shield, QPolygonF>::const_iterator it = shields.constBegin();
-		  it != shields.constEnd(); ++it) {
-			const QPolygonF &p = it.value();
-			QRectF rect(p.boundingRect() & _rect);
+		for (QHash<Shield, ShieldPath>::const_iterator it
+		  = shields.constBegin(); it != shields.constEnd(); ++it) {
+			const ShieldPath &sp = it.value();
+			QRectF rect(sp.bounds & _rect);
 			if (AREA(rect) < AREA(QRect(0, 0, _pixmap.width()/4, _pixmap.width()/4)))
 				continue;
+			if (sp.points.isEmpty())
+				continue;
 
-			QMap<qreal, int> map;
-			QPointF center = rect.center();
-			for (int j = 0; j < p.size(); j++) {
-				QLineF l(p.at(j), center);
-				map.insert(l.length(), j);
-			}
-
-			QMap<qreal, int>::const_iterator jt = map.constBegin();
+			/* Try at most MAX_SHIELD_CANDIDATES positions closest to
+			   the road center */
+			QVector<ShieldCandidate> candidates(sp.points.size());
+			for (int j = 0; j < sp.points.size(); j++)
+				candidates[j] = ShieldCandidate(sp.points.at(j), rect.center());
+			int cnt = qMin(candidates.size(), MAX_SHIELD_CANDIDATES);
+			std::partial_sort(candidates.begin(), candidates.begin() + cnt,
+			  candidates.end());
 
 			TextPointItem *item = new TextPointItem(
-			  p.at(jt.value()).toPoint(), &(sp.value(it.key())->text()),
+			  candidates.first().pos().toPoint(), &(sp.shield->text()),
 			  poiFont(), 0, &shieldColor, 0, shieldBgColor(it.key().type()));
 
 			bool valid = false;
-			while (true) {
+			for (int j = 0; j < cnt; j++) {
+				if (j)
+					item->setPos(candidates.at(j).pos().toPoint());
 				if (!item->collides(textItems)
 				  && _rect.contains(item->boundingRect().toRect())) {
 					valid = true;
 					break;
 				}
-				if (++jt == map.constEnd())
-					break;
-				item->setPos(p.at(jt.value()).toPoint());
 			}
 
 			if (valid)
@@ -403,7 +431,7 @@ void RasterTile::processShields(const QList<MapData::Poly> &lines,
 }
 
 void RasterTile::processPoints(QList<MapData::Point> &points,
-  QList<TextItem*> &textItems)
+  TextItemGrid &textItems)
 {
 	std::sort(points.begin(), points.end());
 
@@ -461,7 +489,7 @@ void RasterTile::render()
 	QList<MapData::Poly> polygons;
 	QList<MapData::Poly> lines;
 	QList<MapData::Point> points;
-	QList<TextItem*> textItems;
+	TextItemGrid textItems;
 
 	fetchData(polygons, lines, points);
 	ll2xy(polygons);
@@ -482,9 +510,9 @@ void RasterTile::render()
 
 	drawPolygons(&painter, polygons);
 	drawLines(&painter, lines);
-	drawTextItems(&painter, textItems);
+	drawTextItems(&painter, textItems.items());
 
-	qDeleteAll(textItems);
+	qDeleteAll(textItems.items());
 
 	_valid = true;
 
@@ -5,6 +5,7 @@
 #include "mapdata.h"
 #include "map/projection.h"
 #include "map/transform.h"
+#include "map/textitemgrid.h"
 
 class QPainter;
 class IMGMap;
@@ -43,15 +44,15 @@ private:
 	void drawTextItems(QPainter *painter, const QList<TextItem*> &textItems);
 
 	void processPolygons(const QList<MapData::Poly> &polygons,
-	  QList<TextItem *> &textItems);
+	  TextItemGrid &textItems);
 	void processLines(QList<MapData::Poly> &lines,
-	  QList<TextItem*> &textItems);
+	  TextItemGrid &textItems);
 	void processPoints(QList<MapData::Point> &points,
-	  QList<TextItem*> &textItems);
+	  TextItemGrid &textItems);
 	void processShields(const QList<MapData::Poly> &lines,
-	  QList<TextItem*> &textItems);
+	  TextItemGrid &textItems);
 	void processStreetNames(const QList<MapData::Poly> &lines,
-	  QList<TextItem*> &textItems);
+	  TextItemGrid &textItems);
 
 	Projection _proj;
 	Transform _transform;
@@ -15,21 +15,34 @@ bool SubFile::seek(Handle &handle, quint32 pos) const
 		if (handle._blockNum != blockNum) {
 			if (blockNum >= _blocks->size())
 				return false;
-			if (!_img->readBlock(handle._file, _blocks->at(blockNum),
-			  handle._data.data()))
+			if (handle._map) {
+				quint64 offset = (quint64)_blocks->at(blockNum) << blockBits;
+				if (offset + (1ULL<<blockBits) > handle._mapSize)
+					return false;
+				handle._data = handle._map + offset;
+			} else if (!_img->readBlock(handle._file, _blocks->at(blockNum),
+			  handle._buffer.data()))
 				return false;
 			handle._blockNum = blockNum;
 		}
 
 		handle._blockPos = mod2n(pos, 1U<<blockBits);
 		handle._pos = pos;
+	} else if (handle._map) {
+		if (pos >= handle._mapSize)
+			return false;
+
+		handle._data = handle._map;
+		handle._blockNum = 0;
+		handle._blockPos = pos;
+		handle._pos = pos;
 	} else {
 		int blockNum = pos >> BLOCK_BITS;
 
 		if (handle._blockNum != blockNum) {
 			if (!handle._file.seek((quint64)blockNum << BLOCK_BITS))
 				return false;
-			if (handle._file.read(handle._data.data(), (1<<BLOCK_BITS)) < 0)
+			if (handle._file.read(handle._buffer.data(), (1<<BLOCK_BITS)) < 0)
 				return false;
 			handle._blockNum = blockNum;
 		}
@@ -41,6 +54,50 @@ bool SubFile::seek(Handle &handle, quint32 pos) const
 	return true;
 }
 
+bool SubFile::map()
+{
+	if (!_path || _gmp)
+		return false;
+	if (_map)
+		return true;
+
+	_file = new QFile(*_path);
+	if (_file->open(QIODevice::ReadOnly))
+		_map = _file->map(0, _file->size());
+	if (!_map) {
+		delete _file;
+		_file = 0;
+		return false;
+	}
+	_mapSize = _file->size();
+	/* The mapping stays valid after the file is closed, do not waste file
+	   descriptors on huge GMAP sets */
+	_file->close();
+
+	return true;
+}
+
+void SubFile::unmap()
+{
+	/* Deleting the file removes the mapping */
+	delete _file;
+	_file = 0;
+	_map = 0;
+	_mapSize = 0;
+}
+
+const quint8 *SubFile::mapData(quint64 &size) const
+{
+	if (_img) {
+		size = _img->mapSize();
+		return _img->map();
+	} else {
+		const SubFile *file = _gmp ? _gmp : this;
+		size = file->_mapSize;
+		return file->_map;
+	}
+}
+
 bool SubFile::readVUInt32(Handle &hdl, quint32 &val) const
 {
 	quint8 bytes, shift, b;
@@ -120,22 +177,14 @@ bool SubFile::readVBitfield32(Handle &hdl, quint32 &bitfield) const
 bool SubFile::read(Handle &handle, char *buff, quint32 size) const
 {
 	while (size) {
-		quint32 remaining = handle._data.size() - handle._blockPos;
-		if (size < remaining) {
-			memcpy(buff, handle._data.constData() + handle._blockPos, size);
-			handle._blockPos += size;
-			handle._pos += size;
-			return true;
-		} else {
-			memcpy(buff, handle._data.constData() + handle._blockPos,
-			  remaining);
-			buff += remaining;
-			size -= remaining;
-			handle._blockPos = 0;
-			handle._pos += remaining;
-			if (!seek(handle, handle._pos))
-				return false;
-		}
+		if (available(handle) <= 0 && !seek(handle, handle._pos))
+			return false;
+
+		quint32 len = qMin(size, (quint32)available(handle));
+		memcpy(buff, handle._data + handle._blockPos, len);
+		buff += len;
+		size -= len;
+		skip(handle, len);
 	}
 
 	return true;
@@ -19,40 +19,66 @@ public:
 	{
 	public:
 		Handle(const SubFile *subFile)
-		  : _blockNum(-1), _blockPos(-1), _pos(-1)
+		  : _data(0), _map(0), _mapSize(0), _blockSize(0), _blockNum(-1),
+		  _blockPos(-1), _pos(-1)
 		{
 			if (!subFile)
 				return;
 
-			_data.resize(subFile->blockSize());
-			_file.setFileName(subFile->fileName());
-			_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+			/* Memory mapped files are read directly (zero-copy) and shared
+			   by all the handles, otherwise every handle has its own file
+			   and block buffer. */
+			_map = subFile->mapData(_mapSize);
+			if (_map)
+				_blockSize = subFile->_path
+				  ? (int)_mapSize : subFile->blockSize();
+			else {
+				_buffer.resize(subFile->blockSize());
+				_data = (const quint8*)_buffer.constData();
+				_blockSize = _buffer.size();
+				_file.setFileName(subFile->fileName());
+				_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+			}
 		}
 
 	private:
 		friend class SubFile;
 
 		QFile _file;
-		QByteArray _data;
+		QByteArray _buffer;
+		const quint8 *_data;
+		const quint8 *_map;
+		quint64 _mapSize;
+		int _blockSize;
 		int _blockNum;
 		int _blockPos;
 		int _pos;
 	};
 
 	SubFile(const IMGData *img)
-	  : _gmpOffset(0), _img(img), _blocks(new QVector<quint16>()), _path(0) {}
+	  : _gmpOffset(0), _img(img), _blocks(new QVector<quint16>()), _path(0),
+	  _gmp(0), _file(0), _map(0), _mapSize(0) {}
 	SubFile(const SubFile *gmp, quint32 offset) : _gmpOffset(offset),
-	  _img(gmp->_img), _blocks(gmp->_blocks), _path(gmp->_path) {}
+	  _img(gmp->_img), _blocks(gmp->_blocks), _path(gmp->_path), _gmp(gmp),
+	  _file(0), _map(0), _mapSize(0) {}
 	SubFile(const QString *path)
-	  : _gmpOffset(0), _img(0), _blocks(0), _path(path) {}
+	  : _gmpOffset(0), _img(0), _blocks(0), _path(path), _gmp(0), _file(0),
+	  _map(0), _mapSize(0) {}
 	~SubFile()
 	{
+		unmap();
 		if (!_gmpOffset)
 			delete _blocks;
 	}
 
 	void addBlock(quint16 block) {_blocks->append(block);}
 
+	/* Memory map the sub-file data. Only applicable to standalone (GMAP)
+	   sub-files, IMG sub-files use the IMG file mapping and GMP sub-files
+	   the mapping of their GMP container. */
+	bool map();
+	void unmap();
+
 	bool seek(Handle &handle, quint32 pos) const;
 	quint32 pos(Handle &handle) const {return handle._pos;}
 
@@ -60,10 +86,12 @@ public:
 
 	bool readByte(Handle &handle, quint8 *val) const
 	{
-		*val = handle._data.at(handle._blockPos++);
+		if (handle._blockPos >= handle._blockSize
+		  && !seek(handle, handle._pos))
+			return false;
+		*val = handle._data[handle._blockPos++];
 		handle._pos++;
-		return (handle._blockPos >= handle._data.size())
-		  ? seek(handle, handle._pos) : true;
+		return true;
 	}
 
 	template<typename T>
@@ -79,6 +107,13 @@ public:
 	template<typename T>
 	bool readUInt16(Handle &handle, T &val) const
 	{
+		if (available(handle) >= 2) {
+			const quint8 *p = handle._data + handle._blockPos;
+			val = p[0] | ((quint16)p[1]) << 8;
+			skip(handle, 2);
+			return true;
+		}
+
 		quint8 b0, b1;
 		if (!(readByte(handle, &b0) && readByte(handle, &b1)))
 			return false;
@@ -97,6 +132,13 @@ public:
 
 	bool readUInt24(Handle &handle, quint32 &val) const
 	{
+		if (available(handle) >= 3) {
+			const quint8 *p = handle._data + handle._blockPos;
+			val = p[0] | ((quint32)p[1]) << 8 | ((quint32)p[2]) << 16;
+			skip(handle, 3);
+			return true;
+		}
+
 		quint8 b0, b1, b2;
 		if (!(readByte(handle, &b0) && readByte(handle, &b1)
 		  && readByte(handle, &b2)))
@@ -116,6 +158,14 @@ public:
 
 	bool readUInt32(Handle &handle, quint32 &val) const
 	{
+		if (available(handle) >= 4) {
+			const quint8 *p = handle._data + handle._blockPos;
+			val = p[0] | ((quint32)p[1]) << 8 | ((quint32)p[2]) << 16
+			  | ((quint32)p[3]) << 24;
+			skip(handle, 4);
+			return true;
+		}
+
 		quint8 b0, b1, b2, b3;
 		if (!(readByte(handle, &b0) && readByte(handle, &b1)
 		  && readByte(handle, &b2) && readByte(handle, &b3)))
@@ -125,15 +175,25 @@ public:
 		return true;
 	}
 
-	bool readVUInt32SW(Handle &hdl, quint32 bytes, quint32 &val) const
+	template<typename T>
+	bool readVUIntSW(Handle &hdl, quint32 bytes, T &val) const
 	{
 		quint8 b;
 
 		val = 0;
+
+		if (available(hdl) >= (int)bytes) {
+			const quint8 *p = hdl._data + hdl._blockPos;
+			for (quint32 i = 0; i < bytes; i++)
+				val = (val << 8) | p[i];
+			skip(hdl, bytes);
+			return true;
+		}
+
 		for (quint32 i = bytes; i; i--) {
 			if (!readByte(hdl, &b))
 				return false;
-			val |= ((quint32)b) << ((i-1) * 8);
+			val |= ((T)b) << ((i-1) * 8);
 		}
 
 		return true;
@@ -153,9 +213,27 @@ protected:
 	quint32 _gmpOffset;
 
 private:
+	/* Bytes that can be read directly from the current block (0 if the
+	   handle has not been positioned yet) */
+	int available(const Handle &handle) const
+	{
+		return (handle._blockPos < 0) ? 0
+		  : handle._blockSize - handle._blockPos;
+	}
+	void skip(Handle &handle, int bytes) const
+	{
+		handle._blockPos += bytes;
+		handle._pos += bytes;
+	}
+	const quint8 *mapData(quint64 &size) const;
+
 	const IMGData *_img;
 	QVector<quint16> *_blocks;
 	const QString *_path;
+	const SubFile *_gmp;
+	QFile *_file;
+	uchar *_map;
+	quint64 _mapSize;
 };
 
 }
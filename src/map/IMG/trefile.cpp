@@ -113,6 +113,8 @@ bool TREFile::init()
 			return false;
 	}
 
+	_subdivs = QVector<SubDivTree*>(levelsCount, 0);
+
 	// Get first non-inherited level
 	_firstLevel = -1;
 	for (int i = 0; i < _levels.size(); i++) {
@@ -162,7 +164,7 @@ bool TREFile::load(int idx)
 	SubDivTree *tree = new SubDivTree();
 	const MapLevel &level = _levels.at(idx);
 
-	_subdivs.insert(level.level, tree);
+	_subdivs[idx] = tree;
 
 	quint32 skip = 0;
 	for (int i = 0; i < idx; i++)
@@ -270,16 +272,15 @@ void TREFile::clear()
 {
 	SubDivTree::Iterator jt;
 
-	for (QMap<int, SubDivTree*>::iterator it = _subdivs.begin();
-	  it != _subdivs.end(); ++it) {
-		SubDivTree *tree = *it;
+	for (int i = 0; i < _subdivs.size(); i++) {
+		SubDivTree *tree = _subdivs.at(i);
+		if (!tree)
+			continue;
 		for (tree->GetFirst(jt); !tree->IsNull(jt); tree->GetNext(jt))
 			delete tree->GetAt(jt);
+		delete tree;
+		_subdivs[i] = 0;
 	}
-
-	qDeleteAll(_subdivs);
-
-	_subdivs.clear();
 }
 
 const TREFile::SubDivTree *TREFile::subdivs(const Zoom &zoom)
@@ -296,10 +297,10 @@ const TREFile::SubDivTree *TREFile::subdivs(const Zoom &zoom)
 	if (idx < 0)
 		return 0;
 
-	if (!_subdivs.contains(_levels.at(idx).level) && !load(idx))
+	if (!_subdivs.at(idx) && !load(idx))
 		return 0;
 
-	return _subdivs.value(_levels.at(idx).level);
+	return _subdivs.at(idx);
 }
 
 static bool cb(SubDiv *subdiv, void *context)
@@ -53,7 +53,9 @@ private:
 	quint16 _extItemSize;
 	int _firstLevel;
 
-	QMap<int, SubDivTree*> _subdivs;
+	/* Subdivisions R-trees indexed by the level index, the trees are
+	   loaded on first use */
+	QVector<SubDivTree*> _subdivs;
 };
 
 }
@@ -72,22 +72,40 @@ bool VectorTile::initGMP()
 bool VectorTile::load(SubFile::Handle &rgnHdl, SubFile::Handle &lblHdl,
   SubFile::Handle &netHdl, SubFile::Handle &nodHdl)
 {
-	_loaded = -1;
-
-	if (!_rgn->load(rgnHdl))
-		return false;
-	if (_lbl && !_lbl->load(lblHdl, _rgn, rgnHdl))
-		return false;
-	if (_net && !_net->load(netHdl, _rgn, rgnHdl))
-		return false;
-	if (_nod && !_nod->load(nodHdl))
+	/* The failed state is final and checked without the lock in subdivs(), so
+	   it must only be set once the load has really failed, not while it is
+	   still in progress. */
+	if (!_rgn->load(rgnHdl)
+	  || (_lbl && !_lbl->load(lblHdl, _rgn, rgnHdl))
+	  || (_net && !_net->load(netHdl, _rgn, rgnHdl))
+	  || (_nod && !_nod->load(nodHdl))) {
+		_loaded.storeRelease(-1);
 		return false;
+	}
 
-	_loaded = 1;
+	_loaded.storeRelease(1);
 
 	return true;
 }
 
+void VectorTile::map()
+{
+	/* Only standalone (GMAP) sub-files get mapped here, IMG sub-files use
+	   the IMG file mapping. */
+	if (_gmp)
+		_gmp->map();
+	else {
+		_tre->map();
+		_rgn->map();
+		if (_lbl)
+			_lbl->map();
+		if (_net)
+			_net->map();
+		if (_nod)
+			_nod->map();
+	}
+}
+
 void VectorTile::clear()
 {
 	_tre->clear();
@@ -97,141 +115,225 @@ void VectorTile::clear()
 	if (_net)
 		_net->clear();
 
-	_loaded = 0;
+	if (_gmp)
+		_gmp->unmap();
+	else {
+		_tre->unmap();
+		_rgn->unmap();
+		if (_lbl)
+			_lbl->unmap();
+		if (_net)
+			_net->unmap();
+		if (_nod)
+			_nod->unmap();
+	}
+
+	_loaded.storeRelease(0);
 }
 
-void VectorTile::polys(const RectC &rect, const Zoom &zoom,
-  QList<MapData::Poly> *polygons, QList<MapData::Poly> *lines,
-  MapData::PolyCache *polyCache, QMutex *lock)
+bool VectorTile::subdivs(const RectC &rect, const Zoom &zoom,
+  QList<SubDiv*> &list)
 {
-	SubFile::Handle *rgnHdl = 0, *lblHdl = 0, *netHdl = 0, *nodHdl = 0,
-	  *nodHdl2 = 0;
+	/* Only the final failed state may be checked without the lock, a tile
+	   that is not loaded yet may just be loading in another thread */
+	if (_loaded.loadAcquire() < 0)
+		return false;
 
-	lock->lock();
+	_lock.lock();
 
-	if (_loaded < 0) {
-		lock->unlock();
-		return;
+	if (_loaded.loadAcquire() < 0) {
+		_lock.unlock();
+		return false;
 	}
 
-	if (!_loaded) {
-		rgnHdl = new SubFile::Handle(_rgn);
-		lblHdl = new SubFile::Handle(_lbl);
-		netHdl = new SubFile::Handle(_net);
-		nodHdl = new SubFile::Handle(_nod);
-
-		if (!load(*rgnHdl, *lblHdl, *netHdl, *nodHdl)) {
-			lock->unlock();
-			delete rgnHdl; delete lblHdl; delete netHdl; delete nodHdl;
-			return;
+	if (!_loaded.loadAcquire()) {
+		/* The sub-files are mapped only when the tile is really used, the
+		   handles must be created after the mapping */
+		map();
+		SubFile::Handle rgnHdl(_rgn), lblHdl(_lbl), netHdl(_net), nodHdl(_nod);
+		if (!load(rgnHdl, lblHdl, netHdl, nodHdl)) {
+			_lock.unlock();
+			return false;
 		}
 	}
 
-	QList<SubDiv*> subdivs = _tre->subdivs(rect, zoom);
+	list = _tre->subdivs(rect, zoom);
+
+	_lock.unlock();
+
+	return true;
+}
+
+void VectorTile::decoded(const SubDiv *subdiv, QSet<const SubDiv*> &busy)
+{
+	_lock.lock();
+	busy.remove(subdiv);
+	_decoded.wakeAll();
+	_lock.unlock();
+}
+
+void VectorTile::polys(const RectC &rect, const Zoom &zoom,
+  QList<MapData::Poly> *polygons, QList<MapData::Poly> *lines,
+  MapData::PolyCache *polyCache)
+{
+	SubFile::Handle *rgnHdl = 0, *lblHdl = 0, *netHdl = 0, *nodHdl = 0,
+	  *nodHdl2 = 0;
+	QList<SubDiv*> subdivs;
+
+	if (!this->subdivs(rect, zoom, subdivs))
+		return;
+
 	for (int i = 0; i < subdivs.size(); i++) {
 		SubDiv *subdiv = subdivs.at(i);
+		MapData::PolyCache::Shard &shard = polyCache->shard(subdiv);
+
+		/* Cache hits only lock the cache shard, the tile lock is needed
+		   only when the subdivision data must be decoded */
+		shard.lock.lock();
+		MapData::Polys *polys = shard.cache.object(subdiv);
+		if (polys) {
+			polys->polygons(rect, polygons);
+			polys->lines(rect, lines);
+			shard.lock.unlock();
+			continue;
+		}
+		shard.lock.unlock();
+
+		_lock.lock();
+
+		/* Wait for the subdivision if it is just being decoded by another
+		   thread, it may have also been decoded while we were waiting for
+		   the lock */
+		while (_polysBusy.contains(subdiv))
+			_decoded.wait(&_lock);
+		shard.lock.lock();
+		polys = shard.cache.object(subdiv);
+		if (polys) {
+			polys->polygons(rect, polygons);
+			polys->lines(rect, lines);
+			shard.lock.unlock();
+			_lock.unlock();
+			continue;
+		}
+		shard.lock.unlock();
+
+		quint32 shift = _tre->shift(subdiv->bits());
+		QList<MapData::Poly> p, l;
 
-		MapData::Polys *polys = polyCache->object(subdiv);
-		if (!polys) {
-			quint32 shift = _tre->shift(subdiv->bits());
-			QList<MapData::Poly> p, l;
-
-			if (!rgnHdl) {
-				rgnHdl = new SubFile::Handle(_rgn);
-				lblHdl = new SubFile::Handle(_lbl);
-				netHdl = new SubFile::Handle(_net);
-			}
-
-			if (!subdiv->initialized() && !_rgn->subdivInit(*rgnHdl, subdiv))
-				continue;
-
-			_rgn->polyObjects(*rgnHdl, subdiv, RGNFile::Polygon, _lbl, *lblHdl,
-			  _net, *netHdl, &p);
-			_rgn->polyObjects(*rgnHdl, subdiv, RGNFile::Line, _lbl, *lblHdl,
-			  _net, *netHdl, &l);
-			_rgn->extPolyObjects(*rgnHdl, subdiv, shift, RGNFile::Polygon, _lbl,
-			  *lblHdl, &p);
-			_rgn->extPolyObjects(*rgnHdl, subdiv, shift, RGNFile::Line, _lbl,
-			  *lblHdl, &l);
-
-			if (_net && _net->hasLinks()) {
-				if (!nodHdl)
-					nodHdl = new SubFile::Handle(_nod);
-				if (!nodHdl2)
-					nodHdl2 = new SubFile::Handle(_nod);
-				_rgn->links(*rgnHdl, subdiv, shift, _net, *netHdl, _nod, *nodHdl,
-				  *nodHdl2, _lbl, *lblHdl, &l);
-			}
-
-			copyPolys(rect, &p, polygons);
-			copyPolys(rect, &l, lines);
-			polyCache->insert(subdiv, new MapData::Polys(p, l));
-		} else {
-			copyPolys(rect, &(polys->polygons), polygons);
-			copyPolys(rect, &(polys->lines), lines);
+		if (!rgnHdl) {
+			rgnHdl = new SubFile::Handle(_rgn);
+			lblHdl = new SubFile::Handle(_lbl);
+			netHdl = new SubFile::Handle(_net);
 		}
-	}
 
-	lock->unlock();
+		if (!subdiv->initialized() && !_rgn->subdivInit(*rgnHdl, subdiv)) {
+			_lock.unlock();
+			continue;
+		}
+		_polysBusy.insert(subdiv);
+
+		_lock.unlock();
+
+		_rgn->polyObjects(*rgnHdl, subdiv, RGNFile::Polygon, _lbl, *lblHdl,
+		  _net, *netHdl, &p);
+		_rgn->polyObjects(*rgnHdl, subdiv, RGNFile::Line, _lbl, *lblHdl,
+		  _net, *netHdl, &l);
+		_rgn->extPolyObjects(*rgnHdl, subdiv, shift, RGNFile::Polygon, _lbl,
+		  *lblHdl, &p);
+		_rgn->extPolyObjects(*rgnHdl, subdiv, shift, RGNFile::Line, _lbl,
+		  *lblHdl, &l);
+
+		if (_net && _net->hasLinks()) {
+			if (!nodHdl)
+				nodHdl = new SubFile::Handle(_nod);
+			if (!nodHdl2)
+				nodHdl2 = new SubFile::Handle(_nod);
+			_rgn->links(*rgnHdl, subdiv, shift, _net, *netHdl, _nod, *nodHdl,
+			  *nodHdl2, _lbl, *lblHdl, &l);
+		}
+
+		copyPolys(rect, &p, polygons);
+		copyPolys(rect, &l, lines);
+
+		polys = new MapData::Polys(p, l);
+		shard.lock.lock();
+		polyCache->insert(shard, subdiv, polys, polys->cost());
+		shard.lock.unlock();
+		polyCache->trim();
+
+		decoded(subdiv, _polysBusy);
+	}
 
 	delete rgnHdl; delete lblHdl; delete netHdl; delete nodHdl; delete nodHdl2;
 }
 
 void VectorTile::points(const RectC &rect, const Zoom &zoom,
-  QList<MapData::Point> *points, QCache<const SubDiv *,
-  QList<MapData::Point> > *pointCache, QMutex *lock)
+  QList<MapData::Point> *points, MapData::PointCache *pointCache)
 {
 	SubFile::Handle *rgnHdl = 0, *lblHdl = 0;
+	QList<SubDiv*> subdivs;
 
-	lock->lock();
-
-	if (_loaded < 0) {
-		lock->unlock();
+	if (!this->subdivs(rect, zoom, subdivs))
 		return;
-	}
 
-	if (!_loaded) {
-		rgnHdl = new SubFile::Handle(_rgn);
-		lblHdl = new SubFile::Handle(_lbl);
-		SubFile::Handle nodHdl(_nod);
-		SubFile::Handle netHdl(_net);
+	for (int i = 0; i < subdivs.size(); i++) {
+		SubDiv *subdiv = subdivs.at(i);
+		MapData::PointCache::Shard &shard = pointCache->shard(subdiv);
 
-		if (!load(*rgnHdl, *lblHdl, netHdl, nodHdl)) {
-			lock->unlock();
-			delete rgnHdl; delete lblHdl;
-			return;
+		shard.lock.lock();
+		QList<MapData::Point> *pl = shard.cache.object(subdiv);
+		if (pl) {
+			copyPoints(rect, pl, points);
+			shard.lock.unlock();
+			continue;
 		}
-	}
+		shard.lock.unlock();
 
-	QList<SubDiv*> subdivs = _tre->subdivs(rect, zoom);
-	for (int i = 0; i < subdivs.size(); i++) {
-		SubDiv *subdiv = subdivs.at(i);
+		_lock.lock();
 
-		QList<MapData::Point> *pl = pointCache->object(subdiv);
-		if (!pl) {
-			QList<MapData::Point> p;
+		while (_pointsBusy.contains(subdiv))
+			_decoded.wait(&_lock);
+		shard.lock.lock();
+		pl = shard.cache.object(subdiv);
+		if (pl) {
+			copyPoints(rect, pl, points);
+			shard.lock.unlock();
+			_lock.unlock();
+			continue;
+		}
+		shard.lock.unlock();
 
-			if (!rgnHdl) {
-				rgnHdl = new SubFile::Handle(_rgn);
-				lblHdl = new SubFile::Handle(_lbl);
-			}
+		QList<MapData::Point> p;
 
-			if (!subdiv->initialized() && !_rgn->subdivInit(*rgnHdl, subdiv))
-				continue;
+		if (!rgnHdl) {
+			rgnHdl = new SubFile::Handle(_rgn);
+			lblHdl = new SubFile::Handle(_lbl);
+		}
 
-			_rgn->pointObjects(*rgnHdl, subdiv, RGNFile::Point, _lbl, *lblHdl,
-			  &p);
-			_rgn->pointObjects(*rgnHdl, subdiv, RGNFile::IndexedPoint, _lbl,
-			  *lblHdl, &p);
-			_rgn->extPointObjects(*rgnHdl, subdiv, _lbl, *lblHdl, &p);
+		if (!subdiv->initialized() && !_rgn->subdivInit(*rgnHdl, subdiv)) {
+			_lock.unlock();
+			continue;
+		}
+		_pointsBusy.insert(subdiv);
 
-			copyPoints(rect, &p, points);
-			pointCache->insert(subdiv, new QList<MapData::Point>(p));
-		} else
-			copyPoints(rect, pl, points);
-	}
+		_lock.unlock();
+
+		_rgn->pointObjects(*rgnHdl, subdiv, RGNFile::Point, _lbl, *lblHdl,
+		  &p);
+		_rgn->pointObjects(*rgnHdl, subdiv, RGNFile::IndexedPoint, _lbl,
+		  *lblHdl, &p);
+		_rgn->extPointObjects(*rgnHdl, subdiv, _lbl, *lblHdl, &p);
 
-	lock->unlock();
+		copyPoints(rect, &p, points);
+
+		shard.lock.lock();
+		pointCache->insert(shard, subdiv, new QList<MapData::Point>(p),
+		  MapData::cost(p));
+		shard.lock.unlock();
+		pointCache->trim();
+
+		decoded(subdiv, _pointsBusy);
+	}
 
 	delete rgnHdl; delete lblHdl;
 }
@@ -1,6 +1,10 @@
 #ifndef IMG_VECTORTILE_H
 #define IMG_VECTORTILE_H
 
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSet>
+#include <QAtomicInt>
 #include "trefile.h"
 #include "rgnfile.h"
 #include "lblfile.h"
@@ -20,6 +24,7 @@ public:
 	}
 
 	bool init();
+	void map();
 	void clear();
 
 	const RectC &bounds() const {return _tre->bounds();}
@@ -29,10 +34,9 @@ public:
 
 	void polys(const RectC &rect, const Zoom &zoom,
 	  QList<MapData::Poly> *polygons, QList<MapData::Poly> *lines,
-	  MapData::PolyCache *polyCache, QMutex *lock);
+	  MapData::PolyCache *polyCache);
 	void points(const RectC &rect, const Zoom &zoom,
-	  QList<MapData::Point> *points, QCache<const SubDiv*,
-	  QList<MapData::Point> > *pointCache, QMutex *lock);
+	  QList<MapData::Point> *points, MapData::PointCache *pointCache);
 
 	static bool isTileFile(SubFile::Type type)
 	{
@@ -72,6 +76,8 @@ private:
 	bool initGMP();
 	bool load(SubFile::Handle &rgnHdl, SubFile::Handle &lblHdl,
 	  SubFile::Handle &netHdl, SubFile::Handle &nodHdl);
+	bool subdivs(const RectC &rect, const Zoom &zoom, QList<SubDiv*> &list);
+	void decoded(const SubDiv *subdiv, QSet<const SubDiv*> &busy);
 
 	TREFile *_tre;
 	RGNFile *_rgn;
@@ -80,7 +86,17 @@ private:
 	NODFile *_nod;
 	SubFile *_gmp;
 
-	int _loaded;
+	/* Once-flag of the lazy sub-files loading (-1 failed, 0 not loaded,
+	   1 loaded), checked without the tile lock when already set. */
+	QAtomicInt _loaded;
+	/* The tile lock only guards the loading, the TRE levels lookup and the
+	   subdivisions initialization, the subdivisions data is decoded
+	   in parallel. Subdivisions that are just being decoded are kept in
+	   the busy sets so that they are not decoded twice. */
+	QMutex _lock;
+	QWaitCondition _decoded;
+	QSet<const SubDiv*> _polysBusy;
+	QSet<const SubDiv*> _pointsBusy;
 };
 
 }
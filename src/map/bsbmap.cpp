@@ -1,8 +1,9 @@
 #include <cctype>
 #include <QFileInfo>
 #include <QPainter>
+#include <QPixmapCache>
+#include <QtEndian>
 #include "common/color.h"
-#include "image.h"
 #include "gcs.h"
 #include "pcs.h"
 #include "calibrationpoint.h"
@@ -10,6 +11,8 @@
 
 
 #define LINE_LIMIT 1024
+#define TILE_SIZE 256
+#define BAND_CACHE_SIZE 16777216 /* 16MB */
 
 static inline bool isEOH(const QByteArray &line)
 {
@@ -268,13 +271,14 @@ bool BSBMap::createTransform(QList<ReferencePoint> &points)
 	if (_skew > 0.0 && _skew < 360.0) {
 		QTransform matrix;
 		matrix.rotate(-_skew);
-		QTransform t(QImage::trueMatrix(matrix, _size.width(), _size.height()));
+		_skewTransform = QImage::trueMatrix(matrix, _size.width(),
+		  _size.height());
 
 		for (int i = 0; i < points.size(); i++)
-			points[i].setXY(t.map(points.at(i).xy().toPointF()));
+			points[i].setXY(_skewTransform.map(points.at(i).xy().toPointF()));
 
 		QPolygonF a(QRectF(0, 0, _size.width(), _size.height()));
-		a = t.map(a);
+		a = _skewTransform.map(a);
 		_skewSize = a.boundingRect().toAlignedRect().size();
 	}
 
@@ -367,30 +371,91 @@ bool BSBMap::readRow(QFile &file, char bits, uchar *buf)
 	return true;
 }
 
-QImage BSBMap::readImage()
+bool BSBMap::readIndex()
 {
-	QFile file(path());
-	char bits;
+	quint32 offset;
+	qint64 size = _file.size();
+
+	/* The KAP files end with a table of the rows offsets followed by
+	   the table offset */
+	if (_file.seek(size - 4)
+	  && _file.read((char*)&offset, sizeof(offset)) == sizeof(offset)) {
+		offset = qFromBigEndian(offset);
+		qint64 end = offset + 4 * (qint64)_size.height();
+
+		if (offset > _dataOffset && end <= size - 4 && _file.seek(offset)) {
+			QByteArray ba(_file.read(4 * _size.height()));
+
+			if (ba.size() == 4 * _size.height()) {
+				const uchar *data = (const uchar*)ba.constData();
+				bool valid = true;
+
+				_rows.resize(_size.height());
+				for (int i = 0; i < _rows.size(); i++) {
+					_rows[i] = qFromBigEndian<quint32>(data + 4 * i);
+					if (_rows.at(i) <= _dataOffset || _rows.at(i) >= offset
+					  || (i && _rows.at(i) <= _rows.at(i-1))) {
+						valid = false;
+						break;
+					}
+				}
+
+				if (valid)
+					return true;
+			}
+		}
+	}
 
-	if (!file.open(QIODevice::ReadOnly))
-		return QImage();
-	if (!(file.seek(_dataOffset) && file.getChar(&bits)))
-		return QImage();
+	/* Missing or broken index - build the index by reading all the rows */
+	QByteArray buf(_size.width(), 0);
+
+	_rows.resize(_size.height());
+	if (!_file.seek(_dataOffset + 1))
+		return false;
+	for (int i = 0; i < _rows.size(); i++) {
+		_rows[i] = _file.pos();
+		if (!readRow(_file, _bits, (uchar*)buf.data()))
+			return false;
+	}
+
+	return true;
+}
 
-	QImage img(_size, QImage::Format_Indexed8);
-	img.setColorTable(_palette);
+QImage BSBMap::band(int idx)
+{
+	QImage *img = _bands.object(idx);
+	if (img)
+		return *img;
 
-	for (int row = 0; row < _size.height(); row++) {
-		uchar *bsb_row = img.scanLine(row);
-		if (!readRow(file, bits, bsb_row))
+	int top = idx * TILE_SIZE;
+	int height = qMin(TILE_SIZE, _size.height() - top);
+	QImage band(_size.width(), height, QImage::Format_Indexed8);
+	band.setColorTable(_palette);
+
+	if (!_file.seek(_rows.at(top)))
+		return QImage();
+	for (int row = 0; row < height; row++)
+		if (!readRow(_file, _bits, band.scanLine(row)))
 			return QImage();
-	}
 
-	return img;
+	_bands.insert(idx, new QImage(band), band.sizeInBytes());
+
+	return band;
+}
+
+QPixmap BSBMap::tile(int x, int y)
+{
+	QImage img(band(y));
+	if (img.isNull())
+		return QPixmap();
+
+	return QPixmap::fromImage(img.copy(QRect(x * TILE_SIZE, 0,
+	  qMin(TILE_SIZE, img.width() - x * TILE_SIZE), img.height())));
 }
 
 BSBMap::BSBMap(const QString &fileName, QObject *parent)
-  : Map(fileName, parent), _img(0), _mapRatio(1.0), _dataOffset(-1), _valid(false)
+  : Map(fileName, parent), _mapRatio(1.0), _dataOffset(-1),
+  _bits(0), _bands(BAND_CACHE_SIZE), _valid(false)
 {
 	QFile file(fileName);
 
@@ -407,11 +472,6 @@ BSBMap::BSBMap(const QString &fileName, QObject *parent)
 	_valid = true;
 }
 
-BSBMap::~BSBMap()
-{
-	delete _img;
-}
-
 QPointF BSBMap::ll2xy(const Coordinates &c)
 {
 	return QPointF(_transform.proj2img(_projection.ll2xy(c))) / _mapRatio;
@@ -431,8 +491,45 @@ QRectF BSBMap::bounds()
 
 void BSBMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
-	if (_img)
-		_img->draw(painter, rect, flags);
+	Q_UNUSED(flags);
+
+	if (_rows.isEmpty())
+		return;
+
+	/* Only the tiles of the (unskewed) image that are visible in the
+	   (skewed) rect are decoded and the skew is applied when drawing */
+	QRectF sr(rect.topLeft() * _mapRatio, rect.size() * _mapRatio);
+	QRect ir(_skewTransform.inverted().mapRect(sr).toAlignedRect()
+	  & QRect(QPoint(0, 0), _size));
+	if (ir.isEmpty())
+		return;
+
+	painter->save();
+	painter->setTransform(_skewTransform * QTransform::fromScale(
+	  1.0 / _mapRatio, 1.0 / _mapRatio), true);
+	if (!_skewTransform.isIdentity())
+		painter->setRenderHint(QPainter::SmoothPixmapTransform);
+
+	for (int y = ir.top() / TILE_SIZE; y <= ir.bottom() / TILE_SIZE; y++) {
+		for (int x = ir.left() / TILE_SIZE; x <= ir.right() / TILE_SIZE; x++) {
+			QPixmap pixmap;
+			QString key = path() + "/" + QString::number(x) + "_"
+			  + QString::number(y);
+			if (!QPixmapCache::find(key, &pixmap)) {
+				pixmap = tile(x, y);
+				if (!pixmap.isNull())
+					QPixmapCache::insert(key, pixmap);
+			}
+
+			if (pixmap.isNull())
+				qWarning("%s: error loading tile image", qPrintable(key));
+			else
+				painter->drawPixmap(QPoint(x * TILE_SIZE, y * TILE_SIZE),
+				  pixmap);
+		}
+	}
+
+	painter->restore();
 }
 
 void BSBMap::load(const Projection &in, const Projection &out,
@@ -443,23 +540,26 @@ void BSBMap::load(const Projection &in, const Projection &out,
 
 	_mapRatio = hidpi ? deviceRatio : 1.0;
 
-	if (!_img) {
-		if (_skew > 0.0 && _skew < 360.0) {
-			QTransform matrix;
-			matrix.rotate(-_skew);
-			_img = new Image(readImage().transformed(matrix));
-		} else
-			_img = new Image(readImage());
-	}
+	if (_file.isOpen())
+		return;
 
-	if (_img)
-		_img->setDevicePixelRatio(_mapRatio);
+	_file.setFileName(path());
+	if (!_file.open(QIODevice::ReadOnly)) {
+		qWarning("%s: %s", qPrintable(path()), qPrintable(_file.errorString()));
+		return;
+	}
+	if (!(_file.seek(_dataOffset) && _file.getChar(&_bits) && readIndex())) {
+		qWarning("%s: error reading image data", qPrintable(path()));
+		_rows.clear();
+		_file.close();
+	}
 }
 
 void BSBMap::unload()
 {
-	delete _img;
-	_img = 0;
+	_bands.clear();
+	_rows.clear();
+	_file.close();
 }
 
 Map *BSBMap::create(const QString &path, bool *isMap)
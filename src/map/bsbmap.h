@@ -2,12 +2,15 @@
 #define BSBMAP_H
 
 #include <QColor>
+#include <QFile>
+#include <QCache>
+#include <QImage>
+#include <QTransform>
 #include "transform.h"
 #include "projection.h"
 #include "map.h"
 
-class QFile;
-class Image;
+class QPixmap;
 
 class BSBMap : public Map
 {
@@ -15,7 +18,6 @@ class BSBMap : public Map
 
 public:
 	BSBMap(const QString &fileName, QObject *parent = 0);
-	~BSBMap();
 
 	QString name() const {return _name;}
 
@@ -46,20 +48,29 @@ private:
 	bool createProjection(const QString &datum, const QString &proj,
 	  double params[9], const Coordinates &c);
 	bool createTransform(QList<ReferencePoint> &points);
-	QImage readImage();
 	bool readRow(QFile &file, char bits, uchar *buf);
+	bool readIndex();
+	QImage band(int idx);
+	QPixmap tile(int x, int y);
 
 	QString _name;
 	Projection _projection;
 	Transform _transform;
 	qreal _skew;
-	Image *_img;
+	QTransform _skewTransform;
 	QSize _size;
 	QSize _skewSize;
 	qreal _mapRatio;
 	qint64 _dataOffset;
 	QVector<QRgb> _palette;
 
+	/* The image data is decoded on demand in bands of rows using the rows
+	   offsets index, the decoded bands are cached in _bands. */
+	QFile _file;
+	char _bits;
+	QVector<quint32> _rows;
+	QCache<int, QImage> _bands;
+
 	bool _valid;
 	QString _errorString;
 };
@@ -0,0 +1,65 @@
+#include <climits>
+#include <QList>
+#include <QMutex>
+#include "cachebudget.h"
+
+/* Ordered from the least to the most recently used client */
+static QList<CacheBudget::Client*> clients;
+static qint64 budget = 128 * 1024 * 1024;
+static QMutex lock;
+
+/* Must be called with the lock held. The clients lock their caches in
+   setCacheSize()/trimCache() and never call the CacheBudget methods with their
+   caches locked, so there is no lock inversion. */
+static void trim()
+{
+	qint64 total = 0;
+	for (int i = 0; i < clients.size(); i++)
+		total += clients.at(i)->cacheSize();
+
+	for (int i = 0; i < clients.size() && total > budget; i++) {
+		CacheBudget::Client *client = clients.at(i);
+		qint64 size = client->cacheSize();
+		client->trimCache(qMax(size - (total - budget), (qint64)0));
+		total -= size - client->cacheSize();
+	}
+}
+
+void CacheBudget::setSize(int size)
+{
+	lock.lock();
+	budget = (qint64)size * 1024;
+	for (int i = 0; i < clients.size(); i++)
+		clients.at(i)->setCacheSize((int)qMin(budget, (qint64)INT_MAX));
+	trim();
+	lock.unlock();
+}
+
+void CacheBudget::attach(Client *client)
+{
+	lock.lock();
+	if (!clients.contains(client)) {
+		clients.append(client);
+		client->setCacheSize((int)qMin(budget, (qint64)INT_MAX));
+	}
+	lock.unlock();
+}
+
+void CacheBudget::detach(Client *client)
+{
+	lock.lock();
+	clients.removeOne(client);
+	lock.unlock();
+}
+
+void CacheBudget::use(Client *client)
+{
+	lock.lock();
+	int i = clients.indexOf(client);
+	if (i >= 0) {
+		if (i != clients.size() - 1)
+			clients.move(i, clients.size() - 1);
+		trim();
+	}
+	lock.unlock();
+}
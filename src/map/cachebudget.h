@@ -0,0 +1,34 @@
+#ifndef CACHEBUDGET_H
+#define CACHEBUDGET_H
+
+#include <QtGlobal>
+
+/* Process-wide memory budget of the vector maps data caches. Every loaded map
+   data may use the whole budget, when the caches of all the map data together
+   exceed it, the caches of the least recently used map data are trimmed
+   first, so an idle map does not keep memory the active one could use. */
+class CacheBudget
+{
+public:
+	class Client
+	{
+	public:
+		virtual ~Client() {}
+
+		/* Sets the maximal size of the client caches in bytes */
+		virtual void setCacheSize(int size) = 0;
+		/* Returns the current size of the client caches in bytes */
+		virtual qint64 cacheSize() const = 0;
+		/* Shrinks the client caches to at most size bytes */
+		virtual void trimCache(qint64 size) = 0;
+	};
+
+	static void setSize(int size);
+	static void attach(Client *client);
+	static void detach(Client *client);
+	/* Marks the client as the most recently used one and enforces the
+	   budget. Must not be called with any of the client caches locked. */
+	static void use(Client *client);
+};
+
+#endif // CACHEBUDGET_H
@@ -0,0 +1,170 @@
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QPixmap>
+#include <QImage>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QMutex>
+#include <QSet>
+#include <QtConcurrent>
+#include "diskcache.h"
+
+#define FORMAT "PNG"
+/* Minimal interval between the access time updates of a cached file, in
+   seconds. Keeps the cache hits from writing to the disk all the time. */
+#define TOUCH_INTERVAL 3600
+
+static bool olderThan(const QFileInfo &fi1, const QFileInfo &fi2)
+{
+	return fi1.lastModified() < fi2.lastModified();
+}
+
+/* The cache files modification time is used as the access time, so that the
+   trim evicts the least recently used files, not the oldest ones. */
+static void touch(const QString &path)
+{
+	QFile f(path);
+	if (!f.open(QIODevice::ReadWrite))
+		return;
+
+	QDateTime now(QDateTime::currentDateTimeUtc());
+	if (f.fileTime(QFileDevice::FileModificationTime).secsTo(now)
+	  > TOUCH_INTERVAL)
+		f.setFileTime(now, QFileDevice::FileModificationTime);
+}
+
+static void trimDir(const QString &root, qint64 maxSize)
+{
+	/* Several maps may share the cache root, one running trim is enough */
+	static QMutex lock;
+	static QSet<QString> running;
+
+	lock.lock();
+	if (running.contains(root)) {
+		lock.unlock();
+		return;
+	}
+	running.insert(root);
+	lock.unlock();
+
+	QDirIterator it(root, QDir::Files, QDirIterator::Subdirectories);
+	QFileInfoList files;
+	qint64 size = 0;
+
+	while (it.hasNext()) {
+		it.next();
+		files.append(it.fileInfo());
+		size += it.fileInfo().size();
+	}
+
+	if (size > maxSize) {
+		std::sort(files.begin(), files.end(), olderThan);
+
+		for (int i = 0; i < files.size() && size > maxSize; i++) {
+			const QFileInfo &fi = files.at(i);
+			if (QFile::remove(fi.absoluteFilePath()))
+				size -= fi.size();
+		}
+	}
+
+	lock.lock();
+	running.remove(root);
+	lock.unlock();
+}
+
+DiskCache::DiskCache(const QString &root, const QByteArray &id,
+  qint64 maxSize) : _root(root), _maxSize(maxSize)
+{
+	QString dir(QDir(root).filePath(QString::fromLatin1(
+	  QCryptographicHash::hash(id, QCryptographicHash::Md5).toHex())));
+
+	if (!QDir().mkpath(dir))
+		qWarning("%s: %s", qPrintable(dir), "Error creating cache directory");
+	else
+		_dir = dir;
+}
+
+QString DiskCache::file(const QString &key) const
+{
+	return _dir + QLatin1Char('/') + key + QLatin1String(".png");
+}
+
+bool DiskCache::find(const QString &key, QPixmap &pixmap) const
+{
+	if (isNull())
+		return false;
+
+	QString path(file(key));
+	if (!pixmap.load(path, FORMAT))
+		return false;
+	touch(path);
+
+	return true;
+}
+
+void DiskCache::insert(const QString &key, const QPixmap &pixmap) const
+{
+	if (isNull())
+		return;
+
+	/* The file is written under a temporary name and renamed when complete,
+	   so concurrent readers never see a partially written tile. */
+	QSaveFile f(file(key));
+	if (!f.open(QIODevice::WriteOnly))
+		return;
+	if (pixmap.save(&f, FORMAT))
+		f.commit();
+	else
+		f.cancelWriting();
+}
+
+bool DiskCache::find(const QString &key, QImage &image) const
+{
+	if (isNull())
+		return false;
+
+	QString path(file(key));
+	if (!image.load(path, FORMAT))
+		return false;
+	touch(path);
+
+	return true;
+}
+
+void DiskCache::insert(const QString &key, const QImage &image) const
+{
+	if (isNull())
+		return;
+
+	QSaveFile f(file(key));
+	if (!f.open(QIODevice::WriteOnly))
+		return;
+	if (image.save(&f, FORMAT))
+		f.commit();
+	else
+		f.cancelWriting();
+}
+
+void DiskCache::trim() const
+{
+	if (isNull())
+		return;
+
+	/* Walking the whole cache tree may take a long time, do not block the
+	   caller (the GUI thread when loading a map) */
+	QtConcurrent::run(trimDir, _root, _maxSize);
+}
+
+void DiskCache::clear() const
+{
+	if (isNull())
+		return;
+
+	QDir dir(_dir);
+	QStringList list(dir.entryList(QDir::Files));
+
+	for (int i = 0; i < list.count(); i++)
+		dir.remove(list.at(i));
+}
@@ -0,0 +1,35 @@
+#ifndef DISKCACHE_H
+#define DISKCACHE_H
+
+#include <QString>
+#include <QByteArray>
+
+class QPixmap;
+class QImage;
+
+class DiskCache
+{
+public:
+	DiskCache() : _maxSize(0) {}
+	DiskCache(const QString &root, const QByteArray &id, qint64 maxSize);
+
+	bool isNull() const {return _dir.isNull();}
+	const QString &dir() const {return _dir;}
+
+	bool find(const QString &key, QPixmap &pixmap) const;
+	void insert(const QString &key, const QPixmap &pixmap) const;
+	bool find(const QString &key, QImage &image) const;
+	void insert(const QString &key, const QImage &image) const;
+
+	void trim() const;
+	void clear() const;
+
+private:
+	QString file(const QString &key) const;
+
+	QString _root;
+	QString _dir;
+	qint64 _maxSize;
+};
+
+#endif // DISKCACHE_H
@@ -0,0 +1,290 @@
+#include <QPainter>
+#include <QPixmapCache>
+#include <QtConcurrent>
+#include <QFileInfo>
+#include <QDir>
+#include "common/range.h"
+#include "common/wgs84.h"
+#include "ENC/iso8211.h"
+#include "rectd.h"
+#include "pcs.h"
+#include "encatlas.h"
+
+
+using namespace ENC;
+
+#define TILE_SIZE 512
+
+static bool coordinate(const ISO8211::Field &f, const char *name, double *val)
+{
+	QByteArray ba;
+	bool ok;
+
+	if (!f.subfield(name, &ba))
+		return false;
+	*val = ba.trimmed().toDouble(&ok);
+
+	return ok;
+}
+
+static RectC catalogBounds(const ISO8211::Field &f)
+{
+	double slat, wlon, nlat, elon;
+
+	if (!(coordinate(f, "SLAT", &slat) && coordinate(f, "WLON", &wlon)
+	  && coordinate(f, "NLAT", &nlat) && coordinate(f, "ELON", &elon)))
+		return RectC();
+
+	return RectC(Coordinates(wlon, nlat), Coordinates(elon, slat));
+}
+
+bool ENCAtlas::readCatalog(const QString &path)
+{
+	QDir dir(QFileInfo(path).absoluteDir());
+	ISO8211 ddf(path);
+	ISO8211::Record record;
+
+	if (!ddf.readDDR()) {
+		_errorString = ddf.errorString();
+		return false;
+	}
+
+	while (ddf.readRecord(record)) {
+		const ISO8211::Field *f = record.field("CATD");
+		QByteArray file, impl;
+
+		if (!(f && f->subfield("FILE", &file) && f->subfield("IMPL", &impl)))
+			continue;
+		/* Only the base cells are used, updates are not supported */
+		if (impl.trimmed() != "BIN" || !file.toUpper().endsWith(".000"))
+			continue;
+
+		QString cellPath(dir.filePath(QString::fromLatin1(file.trimmed())
+		  .replace('\\', '/')));
+		if (!QFileInfo::exists(cellPath)) {
+			qWarning("%s: no such cell", qPrintable(cellPath));
+			continue;
+		}
+
+		/* The cell bounds are optional in the catalog, the cell must be
+		   scanned for its bounds in that case */
+		RectC bounds(catalogBounds(*f));
+		if (!bounds.isValid())
+			bounds = MapData(cellPath).bounds();
+		if (!bounds.isValid()) {
+			qWarning("%s: invalid cell bounds", qPrintable(cellPath));
+			continue;
+		}
+
+		_data.addCell(cellPath, bounds);
+	}
+
+	if (!ddf.errorString().isNull()) {
+		_errorString = ddf.errorString();
+		return false;
+	}
+	if (_data.isEmpty()) {
+		_errorString = "No usable ENC cells found";
+		return false;
+	}
+
+	return true;
+}
+
+ENCAtlas::ENCAtlas(const QString &fileName, QObject *parent)
+  : Map(fileName, parent), _projection(PCS::pcs(3857)), _tileRatio(1.0),
+  _zoom(0), _valid(false)
+{
+	if (!readCatalog(fileName))
+		return;
+
+	_name = QFileInfo(fileName).absoluteDir().dirName();
+	_llBounds = _data.bounds();
+	updateTransform();
+
+	connect(&_scheduler, &TileScheduler::finished, this,
+	  &ENCAtlas::tilesLoaded);
+
+	_valid = true;
+}
+
+void ENCAtlas::load(const Projection &in, const Projection &out,
+  qreal deviceRatio, bool hidpi)
+{
+	Q_UNUSED(in);
+	Q_UNUSED(hidpi);
+
+	_tileRatio = deviceRatio;
+	_projection = out;
+	QPixmapCache::clear();
+}
+
+void ENCAtlas::unload()
+{
+	_scheduler.cancel(true);
+	_data.clear();
+}
+
+int ENCAtlas::zoomFit(const QSize &size, const RectC &rect)
+{
+	if (rect.isValid()) {
+		RectD pr(rect, _projection, 10);
+
+		_zoom = _data.zooms().min();
+		for (int i = _data.zooms().min() + 1; i <= _data.zooms().max(); i++) {
+			Transform t(transform(i));
+			QRectF r(t.proj2img(pr.topLeft()), t.proj2img(pr.bottomRight()));
+			if (size.width() < r.width() || size.height() < r.height())
+				break;
+			_zoom = i;
+		}
+	} else
+		_zoom = _data.zooms().max();
+
+	updateTransform();
+
+	return _zoom;
+}
+
+int ENCAtlas::zoomIn()
+{
+	_scheduler.cancel(QRectF());
+
+	_zoom = qMin(_zoom + 1, _data.zooms().max());
+	updateTransform();
+	return _zoom;
+}
+
+int ENCAtlas::zoomOut()
+{
+	_scheduler.cancel(QRectF());
+
+	_zoom = qMax(_zoom - 1, _data.zooms().min());
+	updateTransform();
+	return _zoom;
+}
+
+void ENCAtlas::setZoom(int zoom)
+{
+	_zoom = zoom;
+	updateTransform();
+}
+
+Transform ENCAtlas::transform(int zoom) const
+{
+	int z = zoom + Util::log2i(TILE_SIZE);
+
+	double scale = _projection.isGeographic()
+	  ? 360.0 / (1<<z) : (2.0 * M_PI * WGS84_RADIUS) / (1<<z);
+	PointD topLeft(_projection.ll2xy(_llBounds.topLeft()));
+	return Transform(ReferencePoint(PointD(0, 0), topLeft),
+	  PointD(scale, scale));
+}
+
+void ENCAtlas::updateTransform()
+{
+	_transform = transform(_zoom);
+
+	RectD prect(_llBounds, _projection);
+	_bounds = QRectF(_transform.proj2img(prect.topLeft()),
+	  _transform.proj2img(prect.bottomRight()));
+}
+
+QString ENCAtlas::key(int zoom, const QPoint &xy) const
+{
+	return path() + "-" + QString::number(zoom) + "_"
+	  + QString::number(xy.x()) + "_" + QString::number(xy.y());
+}
+
+void ENCAtlas::draw(QPainter *painter, const QRectF &rect, Flags flags)
+{
+	QPointF tl(floor(rect.left() / TILE_SIZE) * TILE_SIZE,
+	  floor(rect.top() / TILE_SIZE) * TILE_SIZE);
+	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
+	int width = ceil(s.width() / TILE_SIZE);
+	int height = ceil(s.height() / TILE_SIZE);
+
+	QList<RasterTile> tiles;
+
+	for (int i = 0; i < width; i++) {
+		for (int j = 0; j < height; j++) {
+			QPoint ttl(tl.x() + i * TILE_SIZE, tl.y() + j * TILE_SIZE);
+			QString tk(key(_zoom, ttl));
+			if (_scheduler.isRunning(tk))
+				continue;
+
+			QPixmap pm;
+			if (QPixmapCache::find(tk, &pm))
+				painter->drawPixmap(ttl, pm);
+			else
+				tiles.append(RasterTile(_projection, _transform, &_data,
+				  _zoom, QRect(ttl, QSize(TILE_SIZE, TILE_SIZE)), _tileRatio));
+		}
+	}
+
+	if (!tiles.isEmpty()) {
+		if (flags & Map::Block) {
+			QFuture<void> future = QtConcurrent::map(tiles, &RasterTile::render);
+			future.waitForFinished();
+
+			for (int i = 0; i < tiles.size(); i++) {
+				const RasterTile &mt = tiles.at(i);
+				const QPixmap &pm = mt.pixmap();
+				painter->drawPixmap(mt.xy(), pm);
+				QPixmapCache::insert(key(mt.zoom(), mt.xy()), pm);
+			}
+		} else {
+			for (int i = 0; i < tiles.size(); i++) {
+				const RasterTile &mt = tiles.at(i);
+				_scheduler.render(mt, key(mt.zoom(), mt.xy()), QRect(mt.xy(),
+				  QSize(TILE_SIZE, TILE_SIZE)), rect.center());
+			}
+		}
+	}
+}
+
+void ENCAtlas::prefetch(const QRectF &rect, int budget)
+{
+	QRect tiles(QPoint(floor(rect.left() / TILE_SIZE),
+	  floor(rect.top() / TILE_SIZE)), QPoint(ceil(rect.right() / TILE_SIZE) - 1,
+	  ceil(rect.bottom() / TILE_SIZE) - 1));
+
+	_scheduler.cancelPrefetch();
+
+	/* Only the current zoom is prefetched, the neighbouring zooms may
+	   require cells of a different band to be loaded */
+	prefetch(_zoom, prefetchTiles(tiles.adjusted(-1, -1, 1, 1), tiles),
+	  budget);
+}
+
+int ENCAtlas::prefetch(int zoom, const QVector<QPoint> &tiles, int budget)
+{
+	Transform t(transform(zoom));
+	RectD prect(_llBounds, _projection);
+	QRectF bounds(t.proj2img(prect.topLeft()), t.proj2img(prect.bottomRight()));
+	int cnt = 0;
+
+	for (int i = 0; i < tiles.size() && cnt < budget; i++) {
+		QRect tr(tiles.at(i) * TILE_SIZE, QSize(TILE_SIZE, TILE_SIZE));
+		QString tk(key(zoom, tr.topLeft()));
+		QPixmap pm;
+
+		if (!bounds.intersects(tr) || _scheduler.isPending(tk)
+		  || QPixmapCache::find(tk, &pm))
+			continue;
+
+		_scheduler.prefetch(RasterTile(_projection, t, &_data, zoom, tr,
+		  _tileRatio), tk, tr);
+		cnt++;
+	}
+
+	return cnt;
+}
+
+Map *ENCAtlas::create(const QString &path, bool *isDir)
+{
+	if (isDir)
+		*isDir = true;
+
+	return new ENCAtlas(path);
+}
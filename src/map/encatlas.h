@@ -0,0 +1,69 @@
+#ifndef ENCATLAS_H
+#define ENCATLAS_H
+
+#include "map.h"
+#include "projection.h"
+#include "transform.h"
+#include "tilescheduler.h"
+#include "ENC/atlasdata.h"
+#include "ENC/rastertile.h"
+
+class ENCAtlas : public Map
+{
+	Q_OBJECT
+
+public:
+	ENCAtlas(const QString &fileName, QObject *parent = 0);
+
+	QString name() const {return _name;}
+
+	QRectF bounds() {return _bounds;}
+	RectC llBounds(const Projection &) {return _llBounds;}
+
+	int zoom() const {return _zoom;}
+	void setZoom(int zoom);
+	int zoomFit(const QSize &size, const RectC &rect);
+	int zoomIn();
+	int zoomOut();
+
+	void load(const Projection &in, const Projection &out, qreal deviceRatio,
+	  bool hidpi);
+	void unload();
+
+	QPointF ll2xy(const Coordinates &c)
+	  {return _transform.proj2img(_projection.ll2xy(c));}
+	Coordinates xy2ll(const QPointF &p)
+	  {return _projection.xy2ll(_transform.img2proj(p));}
+
+	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void prefetch(const QRectF &rect, int budget);
+	void cancel(const QRectF &rect) {_scheduler.cancel(rect);}
+
+	bool isValid() const {return _valid;}
+	QString errorString() const {return _errorString;}
+
+	static Map *create(const QString &path, bool *isDir);
+
+private:
+	bool readCatalog(const QString &path);
+	Transform transform(int zoom) const;
+	void updateTransform();
+	QString key(int zoom, const QPoint &xy) const;
+	int prefetch(int zoom, const QVector<QPoint> &tiles, int budget);
+
+	QString _name;
+	ENC::AtlasData _data;
+	Projection _projection;
+	Transform _transform;
+	qreal _tileRatio;
+	RectC _llBounds;
+	QRectF _bounds;
+	int _zoom;
+
+	TileScheduler _scheduler;
+
+	bool _valid;
+	QString _errorString;
+};
+
+#endif // ENCATLAS_H
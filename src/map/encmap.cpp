@@ -1,5 +1,6 @@
 #include <QPainter>
 #include <QPixmapCache>
+#include <QtConcurrent>
 #include "common/range.h"
 #include "common/wgs84.h"
 #include "rectd.h"
@@ -19,6 +20,8 @@ ENCMap::ENCMap(const QString &fileName, QObject *parent)
 		_llBounds = _data.bounds();
 		updateTransform();
 	}
+
+	connect(&_scheduler, &TileScheduler::finished, this, &ENCMap::tilesLoaded);
 }
 
 void ENCMap::load(const Projection &in, const Projection &out,
@@ -35,7 +38,7 @@ void ENCMap::load(const Projection &in, const Projection &out,
 
 void ENCMap::unload()
 {
-	cancelJobs(true);
+	_scheduler.cancel(true);
 	_data.clear();
 }
 
@@ -62,7 +65,7 @@ int ENCMap::zoomFit(const QSize &size, const RectC &rect)
 
 int ENCMap::zoomIn()
 {
-	cancelJobs(false);
+	_scheduler.cancel(QRectF());
 
 	_zoom = qMin(_zoom + 1, _data.zooms().max());
 	updateTransform();
@@ -71,7 +74,7 @@ int ENCMap::zoomIn()
 
 int ENCMap::zoomOut()
 {
-	cancelJobs(false);
+	_scheduler.cancel(QRectF());
 
 	_zoom = qMax(_zoom - 1, _data.zooms().min());
 	updateTransform();
@@ -104,55 +107,6 @@ void ENCMap::updateTransform()
 	  _transform.proj2img(prect.bottomRight()));
 }
 
-bool ENCMap::isRunning(int zoom, const QPoint &xy) const
-{
-	for (int i = 0; i < _jobs.size(); i++) {
-		const QList<ENC::RasterTile> &tiles = _jobs.at(i)->tiles();
-		for (int j = 0; j < tiles.size(); j++) {
-			const ENC::RasterTile &mt = tiles.at(j);
-			if (mt.zoom() == zoom && mt.xy() == xy)
-				return true;
-		}
-	}
-
-	return false;
-}
-
-void ENCMap::runJob(ENCMapJob *job)
-{
-	_jobs.append(job);
-
-	connect(job, &ENCMapJob::finished, this, &ENCMap::jobFinished);
-	job->run();
-}
-
-void ENCMap::removeJob(ENCMapJob *job)
-{
-	_jobs.removeOne(job);
-	job->deleteLater();
-}
-
-void ENCMap::jobFinished(ENCMapJob *job)
-{
-	const QList<ENC::RasterTile> &tiles = job->tiles();
-
-	for (int i = 0; i < tiles.size(); i++) {
-		const ENC::RasterTile &mt = tiles.at(i);
-		if (mt.isValid())
-			QPixmapCache::insert(key(mt.zoom(), mt.xy()), mt.pixmap());
-	}
-
-	removeJob(job);
-
-	emit tilesLoaded();
-}
-
-void ENCMap::cancelJobs(bool wait)
-{
-	for (int i = 0; i < _jobs.size(); i++)
-		_jobs.at(i)->cancel(wait);
-}
-
 QString ENCMap::key(int zoom, const QPoint &xy) const
 {
 	return path() + "-" + QString::number(zoom) + "_"
@@ -161,7 +115,6 @@ QString ENCMap::key(int zoom, const QPoint &xy) const
 
 void ENCMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
-	Q_UNUSED(flags);
 	QPointF tl(floor(rect.left() / TILE_SIZE) * TILE_SIZE,
 	  floor(rect.top() / TILE_SIZE) * TILE_SIZE);
 	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
@@ -173,11 +126,12 @@ void ENCMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 	for (int i = 0; i < width; i++) {
 		for (int j = 0; j < height; j++) {
 			QPoint ttl(tl.x() + i * TILE_SIZE, tl.y() + j * TILE_SIZE);
-			if (isRunning(_zoom, ttl))
+			QString tk(key(_zoom, ttl));
+			if (_scheduler.isRunning(tk))
 				continue;
 
 			QPixmap pm;
-			if (QPixmapCache::find(key(_zoom, ttl), &pm))
+			if (QPixmapCache::find(tk, &pm))
 				painter->drawPixmap(ttl, pm);
 			else
 				tiles.append(RasterTile(_projection, _transform, &_data,
@@ -196,11 +150,57 @@ void ENCMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 				painter->drawPixmap(mt.xy(), pm);
 				QPixmapCache::insert(key(mt.zoom(), mt.xy()), pm);
 			}
-		} else
-			runJob(new ENCMapJob(tiles));
+		} else {
+			for (int i = 0; i < tiles.size(); i++) {
+				const RasterTile &mt = tiles.at(i);
+				_scheduler.render(mt, key(mt.zoom(), mt.xy()), QRect(mt.xy(),
+				  QSize(TILE_SIZE, TILE_SIZE)), rect.center());
+			}
+		}
 	}
 }
 
+void ENCMap::prefetch(const QRectF &rect, int budget)
+{
+	QRect tiles(QPoint(floor(rect.left() / TILE_SIZE),
+	  floor(rect.top() / TILE_SIZE)), QPoint(ceil(rect.right() / TILE_SIZE) - 1,
+	  ceil(rect.bottom() / TILE_SIZE) - 1));
+
+	_scheduler.cancelPrefetch();
+
+	budget -= prefetch(_zoom, prefetchTiles(tiles.adjusted(-1, -1, 1, 1),
+	  tiles), budget);
+	if (_zoom > _data.zooms().min())
+		budget -= prefetch(_zoom - 1, prefetchTiles(zoomTiles(tiles, -1)),
+		  budget);
+	if (_zoom < _data.zooms().max())
+		prefetch(_zoom + 1, prefetchTiles(zoomTiles(tiles, 1)), budget);
+}
+
+int ENCMap::prefetch(int zoom, const QVector<QPoint> &tiles, int budget)
+{
+	Transform t(transform(zoom));
+	RectD prect(_llBounds, _projection);
+	QRectF bounds(t.proj2img(prect.topLeft()), t.proj2img(prect.bottomRight()));
+	int cnt = 0;
+
+	for (int i = 0; i < tiles.size() && cnt < budget; i++) {
+		QRect tr(tiles.at(i) * TILE_SIZE, QSize(TILE_SIZE, TILE_SIZE));
+		QString tk(key(zoom, tr.topLeft()));
+		QPixmap pm;
+
+		if (!bounds.intersects(tr) || _scheduler.isPending(tk)
+		  || QPixmapCache::find(tk, &pm))
+			continue;
+
+		_scheduler.prefetch(RasterTile(_projection, t, &_data, zoom, tr,
+		  _tileRatio), tk, tr);
+		cnt++;
+	}
+
+	return cnt;
+}
+
 Map *ENCMap::create(const QString &path, bool *isMap)
 {
 	if (isMap)
@@ -1,48 +1,13 @@
 #ifndef ENCMAP_H
 #define ENCMAP_H
 
-#include <QtConcurrent>
 #include "map.h"
 #include "projection.h"
 #include "transform.h"
+#include "tilescheduler.h"
 #include "ENC/mapdata.h"
 #include "ENC/rastertile.h"
 
-class ENCMapJob : public QObject
-{
-	Q_OBJECT
-
-public:
-	ENCMapJob(const QList<ENC::RasterTile> &tiles)
-	  : _tiles(tiles) {}
-
-	void run()
-	{
-		connect(&_watcher, &QFutureWatcher<void>::finished, this,
-		  &ENCMapJob::handleFinished);
-		_future = QtConcurrent::map(_tiles, &ENC::RasterTile::render);
-		_watcher.setFuture(_future);
-	}
-	void cancel(bool wait)
-	{
-		_future.cancel();
-		if (wait)
-			_future.waitForFinished();
-	}
-	const QList<ENC::RasterTile> &tiles() const {return _tiles;}
-
-signals:
-	void finished(ENCMapJob *job);
-
-private slots:
-	void handleFinished() {emit finished(this);}
-
-private:
-	QFutureWatcher<void> _watcher;
-	QFuture<void> _future;
-	QList<ENC::RasterTile> _tiles;
-};
-
 class ENCMap : public Map
 {
 	Q_OBJECT
@@ -71,23 +36,19 @@ public:
 	  {return _projection.xy2ll(_transform.img2proj(p));}
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void prefetch(const QRectF &rect, int budget);
+	void cancel(const QRectF &rect) {_scheduler.cancel(rect);}
 
 	bool isValid() const {return _data.isValid();}
 	QString errorString() const {return _data.errorString();}
 
 	static Map *create(const QString &path, bool *isMap);
 
-private slots:
-	void jobFinished(ENCMapJob *job);
-
 private:
 	Transform transform(int zoom) const;
 	void updateTransform();
-	bool isRunning(int zoom, const QPoint &xy) const;
-	void runJob(ENCMapJob *job);
-	void removeJob(ENCMapJob *job);
-	void cancelJobs(bool wait);
 	QString key(int zoom, const QPoint &xy) const;
+	int prefetch(int zoom, const QVector<QPoint> &tiles, int budget);
 
 	ENC::MapData _data;
 	Projection _projection;
@@ -97,7 +58,7 @@ private:
 	QRectF _bounds;
 	int _zoom;
 
-	QList<ENCMapJob*> _jobs;
+	TileScheduler _scheduler;
 
 	bool _valid;
 	QString _errorString;
@@ -3,18 +3,24 @@
 #include "common/util.h"
 #include "geotiff.h"
 #include "image.h"
+#include "tiffimage.h"
 #include "geotiffmap.h"
 
 
 GeoTIFFMap::GeoTIFFMap(const QString &fileName, QObject *parent)
-  : Map(fileName, parent), _img(0), _ratio(1.0), _valid(false)
+  : Map(fileName, parent), _tiff(0), _img(0), _ratio(1.0), _valid(false)
 {
-	QImageReader ir(fileName);
-	if (!ir.canRead()) {
-		_errorString = "Unsupported/invalid image file";
-		return;
+	TIFFImage tiff(fileName);
+	if (tiff.isValid())
+		_size = tiff.size();
+	else {
+		QImageReader ir(fileName);
+		if (!ir.canRead()) {
+			_errorString = "Unsupported/invalid image file";
+			return;
+		}
+		_size = ir.size();
 	}
-	_size = ir.size();
 
 	GeoTIFF gt(fileName);
 	if (!gt.isValid()) {
@@ -30,6 +36,7 @@ GeoTIFFMap::GeoTIFFMap(const QString &fileName, QObject *parent)
 
 GeoTIFFMap::~GeoTIFFMap()
 {
+	delete _tiff;
 	delete _img;
 }
 
@@ -50,7 +57,9 @@ QRectF GeoTIFFMap::bounds()
 
 void GeoTIFFMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
-	if (_img)
+	if (_tiff)
+		_tiff->draw(painter, rect, flags);
+	else if (_img)
 		_img->draw(painter, rect, flags);
 }
 
@@ -62,13 +71,25 @@ void GeoTIFFMap::load(const Projection &in, const Projection &out,
 
 	_ratio = hidpi ? deviceRatio : 1.0;
 
-	_img = new Image(path());
-	if (_img)
+	/* Images supported by TIFFImage are decoded on demand by tiles, all other
+	   images are decoded as a whole */
+	_tiff = new TIFFImage(path());
+	if (_tiff->isValid())
+		_tiff->setDevicePixelRatio(_ratio);
+	else {
+		delete _tiff;
+		_tiff = 0;
+
+		_img = new Image(path());
 		_img->setDevicePixelRatio(_ratio);
+		connect(_img, &Image::tilesLoaded, this, &GeoTIFFMap::tilesLoaded);
+	}
 }
 
 void GeoTIFFMap::unload()
 {
+	delete _tiff;
+	_tiff = 0;
 	delete _img;
 	_img = 0;
 }
@@ -6,6 +6,7 @@
 #include "map.h"
 
 class Image;
+class TIFFImage;
 
 class GeoTIFFMap : public Map
 {
@@ -34,6 +35,7 @@ public:
 private:
 	Projection _projection;
 	Transform _transform;
+	TIFFImage *_tiff;
 	Image *_img;
 	QSize _size;
 	qreal _ratio;
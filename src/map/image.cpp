@@ -1,4 +1,10 @@
+#include <cmath>
 #include <QPainter>
+#include <QPixmapCache>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include "common/programpaths.h"
 #include "image.h"
 
 #define TILE_SIZE 256
@@ -8,7 +14,162 @@
 #define OPENGL_SIZE_LIMIT 134217728 /* 128MB */
 #endif
 
-void Image::draw(QPainter *painter, const QRectF &rect, Map::Flags flags)
+#define MAX_LEVELS 8
+#define CACHE_DIR  "pyramid"
+#define CACHE_SIZE 268435456 /* 256MB */
+
+bool Image::_usePyramid = true;
+
+Image::Image(const QString &fileName)
+  : _fileName(fileName), _img(fileName), _levels(0)
+{
+	if (!_usePyramid)
+		return;
+
+	int size = qMax(_img.width(), _img.height());
+	while (_levels < MAX_LEVELS && (size >> (_levels + 1)) >= TILE_SIZE)
+		_levels++;
+	if (!_levels)
+		return;
+
+	/* The pyramid tiles are only valid for the given image file version */
+	QFileInfo fi(fileName);
+	QByteArray id(fi.absoluteFilePath().toUtf8() + '\n'
+	  + QByteArray::number(fi.size()) + '\n'
+	  + QByteArray::number(fi.lastModified().toMSecsSinceEpoch()));
+
+	_cache = DiskCache(QDir(ProgramPaths::tilesDir()).filePath(CACHE_DIR), id,
+	  CACHE_SIZE);
+	_cache.trim();
+
+	connect(&_scheduler, &TileScheduler::finished, this, &Image::tilesLoaded);
+}
+
+int Image::level(QPainter *painter) const
+{
+	/* Required resolution of the image relative to the full resolution */
+	qreal scale = painter->deviceTransform().map(QLineF(0, 0, 1, 0)).length()
+	  * painter->device()->devicePixelRatioF() / _img.devicePixelRatioF();
+
+	for (int i = _levels; i > 0; i--)
+		if (1.0 / (1<<i) >= scale)
+			return i;
+
+	return 0;
+}
+
+static QSize levelSize(const QImage &img, int level)
+{
+	int d = 1<<level;
+	return QSize((img.width() + d - 1) / d, (img.height() + d - 1) / d);
+}
+
+static QImage tile(const QImage &image, const DiskCache &cache, int level,
+  int x, int y)
+{
+	QSize ls(levelSize(image, level));
+	QRect rect(QRect(x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE)
+	  & QRect(QPoint(0, 0), ls));
+	if (rect.isEmpty())
+		return QImage();
+
+	if (!level)
+		return image.copy(rect);
+
+	QImage img;
+	QString key(QString::number(level) + "_" + QString::number(x) + "_"
+	  + QString::number(y));
+	if (cache.find(key, img))
+		return img;
+
+	/* Every pyramid tile is created from the four tiles of the previous
+	   (twice larger) level. The edge tiles of the previous level may be
+	   smaller (or missing), so the source image size must be computed from
+	   the real tile sizes to not scale any transparent area into the tile. */
+	QImage tiles[2][2];
+	for (int i = 0; i < 2; i++)
+		for (int j = 0; j < 2; j++)
+			tiles[i][j] = tile(image, cache, level - 1, 2 * x + i,
+			  2 * y + j);
+
+	QImage src(tiles[0][0].width() + tiles[1][0].width(),
+	  tiles[0][0].height() + tiles[0][1].height(),
+	  QImage::Format_ARGB32_Premultiplied);
+	src.fill(Qt::transparent);
+	QPainter p(&src);
+	for (int i = 0; i < 2; i++)
+		for (int j = 0; j < 2; j++)
+			if (!tiles[i][j].isNull())
+				p.drawImage(i * tiles[0][0].width(), j * tiles[0][0].height(),
+				  tiles[i][j]);
+	p.end();
+
+	img = src.scaled(rect.size(), Qt::IgnoreAspectRatio,
+	  Qt::SmoothTransformation);
+	cache.insert(key, img);
+
+	return img;
+}
+
+/* Pyramid tile rendered by the TileScheduler. The tile holds (shared) copies
+   of the image and the cache, so it does not depend on the Image object. */
+class PyramidTile
+{
+public:
+	PyramidTile(const QImage &img, const DiskCache &cache, int level,
+	  const QPoint &xy) : _img(img), _cache(cache), _level(level), _xy(xy) {}
+
+	QPixmap pixmap() const {return QPixmap::fromImage(_tile);}
+	bool isValid() const {return !_tile.isNull();}
+
+	void render() {_tile = tile(_img, _cache, _level, _xy.x(), _xy.y());}
+
+private:
+	QImage _img;
+	DiskCache _cache;
+	int _level;
+	QPoint _xy;
+	QImage _tile;
+};
+
+void Image::drawLevel(QPainter *painter, const QRectF &rect, int level,
+  Map::Flags flags)
+{
+	QSize ls(levelSize(_img, level));
+	qreal k = _img.devicePixelRatioF() / (1<<level);
+
+	int cols = (ls.width() + TILE_SIZE - 1) / TILE_SIZE;
+	int rows = (ls.height() + TILE_SIZE - 1) / TILE_SIZE;
+	int left = qMax(0, (int)floor(rect.left() * k / TILE_SIZE));
+	int top = qMax(0, (int)floor(rect.top() * k / TILE_SIZE));
+	int right = qMin(cols - 1, (int)floor(rect.right() * k / TILE_SIZE));
+	int bottom = qMin(rows - 1, (int)floor(rect.bottom() * k / TILE_SIZE));
+
+	for (int y = top; y <= bottom; y++) {
+		for (int x = left; x <= right; x++) {
+			QPixmap pixmap;
+			QString key = _fileName + "/pyramid/" + QString::number(level)
+			  + "_" + QString::number(x) + "_" + QString::number(y);
+			QRectF dst(x * TILE_SIZE / k, y * TILE_SIZE / k, TILE_SIZE / k,
+			  TILE_SIZE / k);
+
+			if (QPixmapCache::find(key, &pixmap)) {
+				QRectF src(QPointF(0, 0), QSizeF(pixmap.size()));
+				dst.setSize(src.size() / k);
+				painter->drawPixmap(dst, pixmap, src);
+			} else {
+				/* The tile is created in the background (the whole subtree
+				   of the pyramid may need to be created), the full resolution
+				   image is drawn in the meantime */
+				_scheduler.render(PyramidTile(_img, _cache, level, QPoint(x, y)),
+				  key, dst.toRect(), rect.center());
+				drawImage(painter, dst & rect, flags);
+			}
+		}
+	}
+}
+
+void Image::drawImage(QPainter *painter, const QRectF &rect, Map::Flags flags)
 {
 	qreal ratio = _img.devicePixelRatioF();
 	QRectF sr(rect.topLeft() * ratio, rect.size() * ratio);
@@ -30,6 +191,17 @@ void Image::draw(QPainter *painter, const QRectF &rect, Map::Flags flags)
 		painter->drawImage(rect.topLeft(), _img, sr);
 }
 
+void Image::draw(QPainter *painter, const QRectF &rect, Map::Flags flags)
+{
+	/* Blocking draws (printing) use the full resolution image */
+	int l = (_levels && !(flags & Map::Block)) ? level(painter) : 0;
+
+	if (l)
+		drawLevel(painter, rect, l, flags);
+	else
+		drawImage(painter, rect, flags);
+}
+
 void Image::setDevicePixelRatio(qreal ratio)
 {
 	_img.setDevicePixelRatio(ratio);
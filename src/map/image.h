@@ -1,22 +1,47 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include <QObject>
 #include <QImage>
+#include "diskcache.h"
+#include "tilescheduler.h"
 #include "map.h"
 
 class QPainter;
 
-class Image
+/* Single image map. When enabled, images loaded from a file are drawn using
+   a pyramid of power-of-two reduced resolution tiles when drawn scaled down.
+   The pyramid tiles are created on demand in the background and cached on
+   disk, the full resolution image is drawn until they are available. */
+class Image : public QObject
 {
+	Q_OBJECT
+
 public:
-	Image(const QString &fileName) : _img(fileName) {}
-	Image(const QImage &img) : _img(img) {}
+	Image(const QString &fileName);
+	Image(const QImage &img) : _img(img), _levels(0) {}
 
 	void draw(QPainter *painter, const QRectF &rect, Map::Flags flags);
 	void setDevicePixelRatio(qreal ratio);
 
+	static void usePyramid(bool use) {_usePyramid = use;}
+
+signals:
+	void tilesLoaded();
+
 private:
+	int level(QPainter *painter) const;
+	void drawImage(QPainter *painter, const QRectF &rect, Map::Flags flags);
+	void drawLevel(QPainter *painter, const QRectF &rect, int level,
+	  Map::Flags flags);
+
+	QString _fileName;
 	QImage _img;
+	int _levels;
+	DiskCache _cache;
+	TileScheduler _scheduler;
+
+	static bool _usePyramid;
 };
 
 #endif // IMAGE_H
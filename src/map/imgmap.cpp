@@ -72,6 +72,8 @@ IMGMap::IMGMap(const QString &fileName, bool GMAP, QObject *parent)
 
 	_zoom = _data.first()->zooms().min();
 
+	connect(&_scheduler, &TileScheduler::finished, this, &IMGMap::tilesLoaded);
+
 	_valid = true;
 }
 
@@ -95,7 +97,7 @@ void IMGMap::load(const Projection &in, const Projection &out,
 
 void IMGMap::unload()
 {
-	cancelJobs(true);
+	_scheduler.cancel(true);
 
 	for (int i = 0; i < _data.size(); i++)
 		_data.at(i)->clear();
@@ -126,7 +128,7 @@ int IMGMap::zoomFit(const QSize &size, const RectC &rect)
 
 int IMGMap::zoomIn()
 {
-	cancelJobs(false);
+	_scheduler.cancel(QRectF());
 
 	_zoom = qMin(_zoom + 1, _data.first()->zooms().max());
 	updateTransform();
@@ -135,7 +137,7 @@ int IMGMap::zoomIn()
 
 int IMGMap::zoomOut()
 {
-	cancelJobs(false);
+	_scheduler.cancel(QRectF());
 
 	_zoom = qMax(_zoom - 1, _data.first()->zooms().min());
 	updateTransform();
@@ -169,51 +171,10 @@ void IMGMap::updateTransform()
 		_bounds.adjust(0.5, 0, -0.5, 0);
 }
 
-bool IMGMap::isRunning(const QString &key) const
-{
-	for (int i = 0; i < _jobs.size(); i++) {
-		const QList<IMG::RasterTile> &tiles = _jobs.at(i)->tiles();
-		for (int j = 0; j < tiles.size(); j++)
-			if (tiles.at(j).key() == key)
-				return true;
-	}
-
-	return false;
-}
-
-void IMGMap::runJob(IMGMapJob *job)
-{
-	_jobs.append(job);
-
-	connect(job, &IMGMapJob::finished, this, &IMGMap::jobFinished);
-	job->run();
-}
-
-void IMGMap::removeJob(IMGMapJob *job)
-{
-	_jobs.removeOne(job);
-	job->deleteLater();
-}
-
-void IMGMap::jobFinished(IMGMapJob *job)
-{
-	const QList<IMG::RasterTile> &tiles = job->tiles();
-
-	for (int i = 0; i < tiles.size(); i++) {
-		const IMG::RasterTile &mt = tiles.at(i);
-		if (mt.isValid())
-			QPixmapCache::insert(mt.key(), mt.pixmap());
-	}
-
-	removeJob(job);
-
-	emit tilesLoaded();
-}
-
-void IMGMap::cancelJobs(bool wait)
+QString IMGMap::key(const MapData *data, int zoom, const QPoint &xy) const
 {
-	for (int i = 0; i < _jobs.size(); i++)
-		_jobs.at(i)->cancel(wait);
+	return data->fileName() + "-" + QString::number(zoom) + "_"
+	  + QString::number(xy.x()) + "_" + QString::number(xy.y());
 }
 
 void IMGMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
@@ -231,18 +192,17 @@ void IMGMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 			for (int j = 0; j < height; j++) {
 				QPixmap pm;
 				QPoint ttl(tl.x() + i * TILE_SIZE, tl.y() + j * TILE_SIZE);
-				QString key(_data.at(n)->fileName() + "-" + QString::number(_zoom)
-				  + "_" + QString::number(ttl.x()) + "_" + QString::number(ttl.y()));
+				QString tk(key(_data.at(n), _zoom, ttl));
 
-				if (isRunning(key))
+				if (_scheduler.isRunning(tk))
 					continue;
 
-				if (QPixmapCache::find(key, &pm))
+				if (QPixmapCache::find(tk, &pm))
 					painter->drawPixmap(ttl, pm);
 				else {
 					tiles.append(RasterTile(_projection, _transform, _data.at(n),
 					_zoom, QRect(ttl, QSize(TILE_SIZE, TILE_SIZE)), _tileRatio,
-					key));
+					tk));
 				}
 			}
 		}
@@ -259,9 +219,60 @@ void IMGMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 				painter->drawPixmap(mt.xy(), pm);
 				QPixmapCache::insert(mt.key(), pm);
 			}
-		} else
-			runJob(new IMGMapJob(tiles));
+		} else {
+			for (int i = 0; i < tiles.size(); i++) {
+				const RasterTile &mt = tiles.at(i);
+				_scheduler.render(mt, mt.key(), QRect(mt.xy(), QSize(TILE_SIZE,
+				  TILE_SIZE)), rect.center());
+			}
+		}
+	}
+}
+
+void IMGMap::prefetch(const QRectF &rect, int budget)
+{
+	const Range &zooms = _data.first()->zooms();
+	QRect tiles(QPoint(floor(rect.left() / TILE_SIZE),
+	  floor(rect.top() / TILE_SIZE)), QPoint(ceil(rect.right() / TILE_SIZE) - 1,
+	  ceil(rect.bottom() / TILE_SIZE) - 1));
+
+	_scheduler.cancelPrefetch();
+
+	budget -= prefetch(_zoom, prefetchTiles(tiles.adjusted(-1, -1, 1, 1),
+	  tiles), budget);
+	if (_zoom > zooms.min())
+		budget -= prefetch(_zoom - 1, prefetchTiles(zoomTiles(tiles, -1)),
+		  budget);
+	if (_zoom < zooms.max())
+		prefetch(_zoom + 1, prefetchTiles(zoomTiles(tiles, 1)), budget);
+}
+
+int IMGMap::prefetch(int zoom, const QVector<QPoint> &tiles, int budget)
+{
+	Transform t(transform(zoom));
+	RectD prect(_dataBounds, _projection);
+	QRectF bounds(t.proj2img(prect.topLeft()), t.proj2img(prect.bottomRight()));
+	int cnt = 0;
+
+	for (int i = 0; i < tiles.size() && cnt < budget; i++) {
+		QRect tr(tiles.at(i) * TILE_SIZE, QSize(TILE_SIZE, TILE_SIZE));
+		if (!bounds.intersects(tr))
+			continue;
+
+		for (int n = 0; n < _data.size(); n++) {
+			QString tk(key(_data.at(n), zoom, tr.topLeft()));
+			QPixmap pm;
+
+			if (_scheduler.isPending(tk) || QPixmapCache::find(tk, &pm))
+				continue;
+
+			_scheduler.prefetch(RasterTile(_projection, t, _data.at(n), zoom, tr,
+			  _tileRatio, tk), tk, tr);
+			cnt++;
+		}
 	}
+
+	return cnt;
 }
 
 Map* IMGMap::createIMG(const QString &path, bool *isDir)
@@ -1,49 +1,14 @@
 #ifndef IMGMAP_H
 #define IMGMAP_H
 
-#include <QtConcurrent>
 #include "map.h"
 #include "projection.h"
 #include "transform.h"
+#include "tilescheduler.h"
 #include "IMG/mapdata.h"
 #include "IMG/rastertile.h"
 
 
-class IMGMapJob : public QObject
-{
-	Q_OBJECT
-
-public:
-	IMGMapJob(const QList<IMG::RasterTile> &tiles)
-	  : _tiles(tiles) {}
-
-	void run()
-	{
-		connect(&_watcher, &QFutureWatcher<void>::finished, this,
-		  &IMGMapJob::handleFinished);
-		_future = QtConcurrent::map(_tiles, &IMG::RasterTile::render);
-		_watcher.setFuture(_future);
-	}
-	void cancel(bool wait)
-	{
-		_future.cancel();
-		if (wait)
-			_future.waitForFinished();
-	}
-	const QList<IMG::RasterTile> &tiles() const {return _tiles;}
-
-signals:
-	void finished(IMGMapJob *job);
-
-private slots:
-	void handleFinished() {emit finished(this);}
-
-private:
-	QFutureWatcher<void> _watcher;
-	QFuture<void> _future;
-	QList<IMG::RasterTile> _tiles;
-};
-
 class IMGMap : public Map
 {
 	Q_OBJECT
@@ -69,6 +34,8 @@ public:
 	  {return _projection.xy2ll(_transform.img2proj(p));}
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void prefetch(const QRectF &rect, int budget);
+	void cancel(const QRectF &rect) {_scheduler.cancel(rect);}
 
 	void load(const Projection &in, const Projection &out, qreal devicelRatio,
 	  bool hidpi);
@@ -80,16 +47,11 @@ public:
 	static Map* createIMG(const QString &path, bool *isDir);
 	static Map* createGMAP(const QString &path, bool *isDir);
 
-private slots:
-	void jobFinished(IMGMapJob *job);
-
 private:
 	Transform transform(int zoom) const;
 	void updateTransform();
-	bool isRunning(const QString &key) const;
-	void runJob(IMGMapJob *job);
-	void removeJob(IMGMapJob *job);
-	void cancelJobs(bool wait);
+	QString key(const IMG::MapData *data, int zoom, const QPoint &xy) const;
+	int prefetch(int zoom, const QVector<QPoint> &tiles, int budget);
 
 	QList<IMG::MapData *> _data;
 	int _zoom;
@@ -99,7 +61,7 @@ private:
 	RectC _dataBounds;
 	qreal _tileRatio;
 
-	QList<IMGMapJob*> _jobs;
+	TileScheduler _scheduler;
 
 	bool _valid;
 	QString _errorString;
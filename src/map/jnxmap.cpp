@@ -2,10 +2,12 @@
 #include <QPainter>
 #include <QFileInfo>
 #include <QPixmapCache>
+#include <QtConcurrent>
 #include "common/util.h"
 #include "rectd.h"
 #include "gcs.h"
 #include "pcs.h"
+#include "tile.h"
 #include "jnxmap.h"
 
 
@@ -149,6 +151,9 @@ JNXMap::JNXMap(const QString &fileName, QObject *parent)
 
 	_file.close();
 
+	connect(&_scheduler, &TileScheduler::finished, this,
+	  &JNXMap::tilesLoaded);
+
 	_valid = true;
 }
 
@@ -171,6 +176,7 @@ void JNXMap::load(const Projection &in, const Projection &out,
 
 void JNXMap::unload()
 {
+	_scheduler.cancel(true);
 	_file.close();
 	clearTiles();
 }
@@ -224,54 +230,89 @@ int JNXMap::zoomOut()
 	return _zoom;
 }
 
-QPixmap JNXMap::pixmap(const Tile *tile, QFile *file)
+QString JNXMap::key(const Tile *tile) const
 {
-	QPixmap pm;
-
-	QString key = file->fileName() + "-" + QString::number(tile->offset);
-	if (!QPixmapCache::find(key, &pm)) {
-		QByteArray ba;
-		ba.resize(tile->size + 2);
-		ba[0] = (char)0xFF;
-		ba[1] = (char)0xD8;
-		char *data = ba.data() + 2;
-
-		if (!file->seek(tile->offset))
-			return QPixmap();
-		if (!file->read(data, tile->size))
-			return QPixmap();
-		pm = QPixmap::fromImage(QImage::fromData(ba));
-
-		if (!pm.isNull())
-			QPixmapCache::insert(key, pm);
-	}
+	return _file.fileName() + "-" + QString::number(tile->offset);
+}
 
-	return pm;
+QByteArray JNXMap::tileData(const Tile *tile)
+{
+	/* The JPEG SOI marker is missing in the tile data */
+	QByteArray ba;
+	ba.resize(tile->size + 2);
+	ba[0] = (char)0xFF;
+	ba[1] = (char)0xD8;
+
+	if (!_file.seek(tile->offset))
+		return QByteArray();
+	if (_file.read(ba.data() + 2, tile->size) != (qint64)tile->size)
+		return QByteArray();
+
+	return ba;
 }
 
 bool JNXMap::cb(Tile *tile, void *context)
 {
-	Ctx *ctx = static_cast<Ctx*>(context);
-	QPixmap pm(pixmap(tile, ctx->file));
-	pm.setDevicePixelRatio(ctx->ratio);
-	ctx->painter->drawPixmap(tile->pos / ctx->ratio, pm);
+	QList<const Tile*> *list = static_cast<QList<const Tile*>*>(context);
+	list->append(tile);
 
 	return true;
 }
 
 void JNXMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
-	Q_UNUSED(flags);
 	const RTree<Tile*, qreal, 2> &tree = _zooms.at(_zoom)->tree;
-	Ctx ctx(painter, &_file, _mapRatio);
 	QRectF rr(rect.topLeft() * _mapRatio, rect.size() * _mapRatio);
+	QList<const Tile*> list, missing;
+	QList<RenderTile> tiles;
 
 	qreal min[2], max[2];
 	min[0] = rr.left();
 	min[1] = rr.top();
 	max[0] = rr.right();
 	max[1] = rr.bottom();
-	tree.Search(min, max, cb, &ctx);
+	tree.Search(min, max, cb, &list);
+
+	/* The tiles data is read sequentially, the images are decoded
+	   in parallel, in the background unless the drawing must block
+	   (printing) */
+	for (int i = 0; i < list.size(); i++) {
+		const Tile *tile = list.at(i);
+		QString tk(key(tile));
+		QPixmap pm;
+
+		if (QPixmapCache::find(tk, &pm)) {
+			pm.setDevicePixelRatio(_mapRatio);
+			painter->drawPixmap(tile->pos / _mapRatio, pm);
+		} else if (!(flags & Map::Block)
+		  && _scheduler.promote(tk, rect.center()))
+			continue;
+		else {
+			RenderTile t(QPoint(), tileData(tile), tk);
+			if (flags & Map::Block) {
+				tiles.append(t);
+				missing.append(tile);
+			} else
+				_scheduler.render(t, tk, QRectF(tile->pos / _mapRatio,
+				  QSizeF(tile->width, tile->height) / _mapRatio).toRect(),
+				  rect.center());
+		}
+	}
+
+	QFuture<void> future = QtConcurrent::map(tiles, &RenderTile::load);
+	future.waitForFinished();
+
+	for (int i = 0; i < tiles.size(); i++) {
+		const RenderTile &mt = tiles.at(i);
+		QPixmap pm(mt.pixmap());
+		if (pm.isNull())
+			continue;
+
+		QPixmapCache::insert(mt.key(), pm);
+
+		pm.setDevicePixelRatio(_mapRatio);
+		painter->drawPixmap(missing.at(i)->pos / _mapRatio, pm);
+	}
 }
 
 Map *JNXMap::create(const QString &path, bool *isDir)
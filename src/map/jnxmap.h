@@ -7,6 +7,7 @@
 #include "common/rectc.h"
 #include "transform.h"
 #include "projection.h"
+#include "tilescheduler.h"
 #include "map.h"
 
 class JNXMap : public Map
@@ -35,6 +36,7 @@ public:
 	void unload();
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void cancel(const QRectF &rect) {_scheduler.cancel(rect);}
 
 	bool isValid() const {return _valid;}
 	QString errorString() const {return _errorString;}
@@ -67,16 +69,6 @@ private:
 		RTree<Tile*, qreal, 2> tree;
 	};
 
-	struct Ctx {
-		QPainter *painter;
-		QFile *file;
-		qreal ratio;
-
-		Ctx(QPainter *painter, QFile *file, qreal ratio)
-		  : painter(painter), file(file), ratio(ratio) {}
-	};
-
-
 	template<class T> bool readValue(T &val);
 	bool readString(QByteArray &ba);
 	bool readHeader();
@@ -84,7 +76,8 @@ private:
 	void clearTiles();
 
 	static bool cb(Tile *tile, void *context);
-	static QPixmap pixmap(const Tile *tile, QFile *file);
+	QByteArray tileData(const Tile *tile);
+	QString key(const Tile *tile) const;
 
 	QFile _file;
 	QList<Zoom*> _zooms;
@@ -95,6 +88,8 @@ private:
 
 	bool _valid;
 	QString _errorString;
+
+	TileScheduler _scheduler;
 };
 
 #endif // JNXMAP_H
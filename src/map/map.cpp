@@ -5,6 +5,26 @@
 
 #define SAMPLES 100
 
+class CenterDistance
+{
+public:
+	CenterDistance(const QPointF &center) : _center(center) {}
+
+	bool operator()(const QPoint &t1, const QPoint &t2) const
+	{
+		return (distance(t1) < distance(t2));
+	}
+
+private:
+	qreal distance(const QPoint &tile) const
+	{
+		return (QPointF(tile.x() + 0.5, tile.y() + 0.5) - _center)
+		  .manhattanLength();
+	}
+
+	QPointF _center;
+};
+
 static void growLeft(const Coordinates &c, RectC &rect)
 {
 	if (c.lon() < rect.left())
@@ -69,3 +89,29 @@ qreal Map::resolution(const QRectF &rect)
 
 	return ds/ps;
 }
+
+QRect Map::zoomTiles(const QRect &tiles, int zoomDiff)
+{
+	if (zoomDiff >= 0)
+		return QRect(tiles.left() << zoomDiff, tiles.top() << zoomDiff,
+		  tiles.width() << zoomDiff, tiles.height() << zoomDiff);
+	else
+		return QRect(QPoint(tiles.left() >> -zoomDiff, tiles.top() >> -zoomDiff),
+		  QPoint(tiles.right() >> -zoomDiff, tiles.bottom() >> -zoomDiff));
+}
+
+QVector<QPoint> Map::prefetchTiles(const QRect &tiles, const QRect &exclude)
+{
+	QVector<QPoint> list;
+
+	list.reserve(tiles.width() * tiles.height());
+	for (int i = tiles.left(); i <= tiles.right(); i++)
+		for (int j = tiles.top(); j <= tiles.bottom(); j++)
+			if (!exclude.contains(QPoint(i, j)))
+				list.append(QPoint(i, j));
+
+	/* The tiles closest to the center are the most likely to be needed */
+	std::sort(list.begin(), list.end(), CenterDistance(QRectF(tiles).center()));
+
+	return list;
+}
@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QString>
 #include <QRectF>
+#include <QVector>
 #include <QFlags>
 #include "common/rectc.h"
 #include "common/util.h"
@@ -54,6 +55,13 @@ public:
 	virtual Coordinates xy2ll(const QPointF &p) = 0;
 
 	virtual void draw(QPainter *painter, const QRectF &rect, Flags flags) = 0;
+	/* Loads/renders in the background up to budget tiles surrounding the rect
+	   and the tiles of the neighbouring zoom levels, so that the subsequent
+	   draw() calls find them in the cache. */
+	virtual void prefetch(const QRectF &, int) {}
+	/* Cancels the pending background rendering of the tiles outside of the
+	   rect (the visible part of the map) */
+	virtual void cancel(const QRectF &) {}
 
 	virtual void clearCache() {}
 
@@ -61,6 +69,11 @@ signals:
 	void tilesLoaded();
 	void mapLoaded();
 
+protected:
+	static QRect zoomTiles(const QRect &tiles, int zoomDiff);
+	static QVector<QPoint> prefetchTiles(const QRect &tiles,
+	  const QRect &exclude = QRect());
+
 private:
 	QString _path;
 };
@@ -1,8 +1,10 @@
 #include <cstring>
+#include <climits>
 #include <QtEndian>
 #include <QFile>
 #include <QDataStream>
 #include <QColor>
+#include <QVarLengthArray>
 #include "common/hash.h"
 #include "map/osm.h"
 #include "subfile.h"
@@ -15,6 +17,9 @@ using namespace Mapsforge;
 #define MD(val) ((val) / 1e6)
 #define OFFSET_MASK 0x7FFFFFFFFFL
 
+/* Share of the paths cache in the map data cache budget */
+#define PATH_CACHE_RATIO 0.75
+
 #define KEY_NAME  "name"
 #define KEY_HOUSE "addr:housenumber"
 #define KEY_REF   "ref"
@@ -36,6 +41,42 @@ static void copyPoints(const RectC &rect, const QList<MapData::Point> *src,
 			dst->append(src->at(i));
 }
 
+static int tagsCost(const QVector<MapData::Tag> &tags)
+{
+	int size = tags.size() * sizeof(MapData::Tag);
+
+	for (int i = 0; i < tags.size(); i++)
+		size += tags.at(i).value.size();
+
+	return size;
+}
+
+static int cost(const QList<MapData::Path> &paths)
+{
+	int size = sizeof(paths);
+
+	for (int i = 0; i < paths.size(); i++) {
+		const MapData::Path &path = paths.at(i);
+
+		size += sizeof(MapData::Path) + sizeof(void*) + tagsCost(path.tags);
+		for (int j = 0; j < path.poly.size(); j++)
+			size += path.poly.at(j).size() * sizeof(Coordinates);
+	}
+
+	return size;
+}
+
+static int cost(const QList<MapData::Point> &points)
+{
+	int size = sizeof(points);
+
+	for (int i = 0; i < points.size(); i++)
+		size += sizeof(MapData::Point) + sizeof(void*)
+		  + tagsCost(points.at(i).tags);
+
+	return size;
+}
+
 static double distance(const Coordinates &c1, const Coordinates &c2)
 {
 	return hypot(c1.lon() - c2.lon(), c1.lat() - c2.lat());
@@ -49,23 +90,20 @@ static bool isClosed(const QVector<Coordinates> &poly)
 static bool readSingleDelta(SubFile &subfile, const Coordinates &c,
   int count, QVector<Coordinates> &nodes)
 {
-	qint32 mdLat, mdLon;
+	QVarLengthArray<qint32, 1024> deltas(count * 2);
 
-	if (!(subfile.readVInt32(mdLat) && subfile.readVInt32(mdLon)))
+	if (!subfile.readVInt32(deltas.data(), deltas.size()))
 		return false;
 
-	double lat = c.lat() + MD(mdLat);
-	double lon = c.lon() + MD(mdLon);
+	double lat = c.lat() + MD(deltas.at(0));
+	double lon = c.lon() + MD(deltas.at(1));
 
 	nodes.reserve(count);
 	nodes.append(Coordinates(lon, lat));
 
 	for (int i = 1; i < count; i++) {
-		if (!(subfile.readVInt32(mdLat) && subfile.readVInt32(mdLon)))
-			return false;
-
-		lat = lat + MD(mdLat);
-		lon = lon + MD(mdLon);
+		lat = lat + MD(deltas.at(2 * i));
+		lon = lon + MD(deltas.at(2 * i + 1));
 
 		nodes.append(Coordinates(lon, lat));
 	}
@@ -76,13 +114,13 @@ static bool readSingleDelta(SubFile &subfile, const Coordinates &c,
 static bool readDoubleDelta(SubFile &subfile, const Coordinates &c,
   int count, QVector<Coordinates> &nodes)
 {
-	qint32 mdLat, mdLon;
+	QVarLengthArray<qint32, 1024> deltas(count * 2);
 
-	if (!(subfile.readVInt32(mdLat) && subfile.readVInt32(mdLon)))
+	if (!subfile.readVInt32(deltas.data(), deltas.size()))
 		return false;
 
-	double lat = c.lat() + MD(mdLat);
-	double lon = c.lon() + MD(mdLon);
+	double lat = c.lat() + MD(deltas.at(0));
+	double lon = c.lon() + MD(deltas.at(1));
 	double prevLat = 0;
 	double prevLon = 0;
 
@@ -90,11 +128,8 @@ static bool readDoubleDelta(SubFile &subfile, const Coordinates &c,
 	nodes.append(Coordinates(lon, lat));
 
 	for (int i = 1; i < count; i++) {
-		if (!(subfile.readVInt32(mdLat) && subfile.readVInt32(mdLon)))
-			return false;
-
-		double singleLat = MD(mdLat) + prevLat;
-		double singleLon = MD(mdLon) + prevLon;
+		double singleLat = MD(deltas.at(2 * i)) + prevLat;
+		double singleLon = MD(deltas.at(2 * i + 1)) + prevLon;
 
 		lat += singleLat;
 		lon += singleLon;
@@ -113,12 +148,16 @@ static bool readPolygonPath(SubFile &subfile, const Coordinates &c,
 {
 	quint32 blocks, nodes;
 
-	if (!subfile.readVUInt32(blocks))
+	/* Every block has at least one node and every node two deltas of at
+	   least one byte, reject counts that can not fit in the sub-file before
+	   allocating anything */
+	if (!subfile.readVUInt32(blocks) || blocks > subfile.available())
 		return false;
 
 	polygon.reserve(polygon.size() + blocks);
 	for (quint32 i = 0; i < blocks; i++) {
-		if (!subfile.readVUInt32(nodes) || !nodes)
+		if (!subfile.readVUInt32(nodes) || !nodes || nodes > INT_MAX / 2
+		  || (quint64)nodes * 2 > subfile.available())
 			return false;
 
 		QVector<Coordinates> path;
@@ -380,7 +419,7 @@ bool MapData::readHeader(QFile &file)
 		return false;
 	}
 
-	SubFile hdr(file, MAGIC_SIZE, qFromBigEndian(hdrSize));
+	SubFile hdr(file, MAGIC_SIZE, qFromBigEndian(hdrSize) + sizeof(hdrSize));
 
 	if (!readMapInfo(hdr, projection, debugMap)) {
 		_errorString = "Error reading map info";
@@ -410,7 +449,7 @@ bool MapData::readHeader(QFile &file)
 }
 
 MapData::MapData(const QString &fileName)
-  : _pointFile(fileName), _pathFile(fileName), _valid(false)
+  : _pointFile(fileName), _pathFile(fileName), _map(0), _valid(false)
 {
 	QFile file(fileName);
 
@@ -422,14 +461,12 @@ MapData::MapData(const QString &fileName)
 	if (!readHeader(file))
 		return;
 
-	_pathCache.setMaxCost(256);
-	_pointCache.setMaxCost(256);
-
 	_valid = true;
 }
 
 MapData::~MapData()
 {
+	CacheBudget::detach(this);
 	clearTiles();
 }
 
@@ -450,11 +487,25 @@ void MapData::load()
 	_pointFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
 	_pathFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
 
+	/* The memory mapped file is shared by all the (render) threads. If the
+	   mapping fails (e.g. due to the 32b address space limits), the data is
+	   read using the files. */
+	_map = _pathFile.map(0, _pathFile.size());
+
 	readSubFiles();
+
+	CacheBudget::attach(this);
 }
 
 void MapData::clear()
 {
+	CacheBudget::detach(this);
+
+	if (_map) {
+		_pathFile.unmap(_map);
+		_map = 0;
+	}
+
 	_pointFile.close();
 	_pathFile.close();
 
@@ -464,6 +515,31 @@ void MapData::clear()
 	clearTiles();
 }
 
+void MapData::setCacheSize(int size)
+{
+	int pathSize = (int)(size * PATH_CACHE_RATIO);
+
+	_pathCache.setMaxCost(pathSize);
+	_pointCache.setMaxCost(size - pathSize);
+}
+
+qint64 MapData::cacheSize() const
+{
+	return _pathCache.totalCost() + _pointCache.totalCost();
+}
+
+void MapData::trimCache(qint64 size)
+{
+	qint64 pathCost = _pathCache.totalCost();
+	qint64 total = pathCost + _pointCache.totalCost();
+
+	if (total > size) {
+		qint64 pathSize = (size * pathCost) / total;
+		_pathCache.trim(pathSize);
+		_pointCache.trim(size - pathSize);
+	}
+}
+
 void MapData::clearTiles()
 {
 	TileTree::Iterator it;
@@ -516,6 +592,8 @@ void MapData::points(const RectC &rect, int zoom, QList<Point> *list)
 	max[1] = rect.top();
 
 	_tiles.at(l)->Search(min, max, pointCb, &ctx);
+
+	CacheBudget::use(this);
 }
 
 void MapData::points(const VectorTile *tile, const RectC &rect, int zoom,
@@ -523,21 +601,34 @@ void MapData::points(const VectorTile *tile, const RectC &rect, int zoom,
 {
 	Key key(tile, zoom);
 
-	_pointLock.lock();
-
-	QList<Point> *cached = _pointCache.object(key);
+	PointCache::Shard &shard = _pointCache.shard(key);
 
-	if (!cached) {
-		QList<Point> *p = new QList<Point>();
-		if (readPoints(tile, zoom, p)) {
-			copyPoints(rect, p, list);
-			_pointCache.insert(key, p);
-		} else
-			delete p;
-	} else
+	shard.lock.lock();
+	QList<Point> *cached = shard.cache.object(key);
+	if (cached) {
 		copyPoints(rect, cached, list);
-
-	_pointLock.unlock();
+		shard.lock.unlock();
+		return;
+	}
+	shard.lock.unlock();
+
+	/* The data is decoded without holding the cache lock. Only the reads from
+	   the (not memory mapped) file must be serialized. */
+	QList<Point> *p = new QList<Point>();
+	if (!_map)
+		_pointLock.lock();
+	bool ret = readPoints(tile, zoom, p);
+	if (!_map)
+		_pointLock.unlock();
+
+	if (ret) {
+		copyPoints(rect, p, list);
+		shard.lock.lock();
+		_pointCache.insert(shard, key, p, cost(*p));
+		shard.lock.unlock();
+		_pointCache.trim();
+	} else
+		delete p;
 }
 
 void MapData::paths(const RectC &rect, int zoom, QList<Path> *list)
@@ -555,6 +646,8 @@ void MapData::paths(const RectC &rect, int zoom, QList<Path> *list)
 	max[1] = rect.top();
 
 	_tiles.at(l)->Search(min, max, pathCb, &ctx);
+
+	CacheBudget::use(this);
 }
 
 void MapData::paths(const VectorTile *tile, const RectC &rect, int zoom,
@@ -562,27 +655,39 @@ void MapData::paths(const VectorTile *tile, const RectC &rect, int zoom,
 {
 	Key key(tile, zoom);
 
-	_pathLock.lock();
+	PathCache::Shard &shard = _pathCache.shard(key);
 
-	QList<Path> *cached = _pathCache.object(key);
-
-	if (!cached) {
-		QList<Path> *p = new QList<Path>();
-		if (readPaths(tile, zoom, p)) {
-			copyPaths(rect, p, list);
-			_pathCache.insert(key, p);
-		} else
-			delete p;
-	} else
+	shard.lock.lock();
+	QList<Path> *cached = shard.cache.object(key);
+	if (cached) {
 		copyPaths(rect, cached, list);
-
-	_pathLock.unlock();
+		shard.lock.unlock();
+		return;
+	}
+	shard.lock.unlock();
+
+	/* See points() */
+	QList<Path> *p = new QList<Path>();
+	if (!_map)
+		_pathLock.lock();
+	bool ret = readPaths(tile, zoom, p);
+	if (!_map)
+		_pathLock.unlock();
+
+	if (ret) {
+		copyPaths(rect, p, list);
+		shard.lock.lock();
+		_pathCache.insert(shard, key, p, cost(*p));
+		shard.lock.unlock();
+		_pathCache.trim();
+	} else
+		delete p;
 }
 
 bool MapData::readPaths(const VectorTile *tile, int zoom, QList<Path> *list)
 {
 	const SubFileInfo &info = _subFiles.at(level(zoom));
-	SubFile subfile(_pathFile, info.offset, info.size);
+	SubFile subfile(_pathFile, info.offset, info.size, _map);
 	int rows = info.max - info.min + 1;
 	QVector<unsigned> paths(rows);
 	quint32 blocks, unused, val, cnt = 0;
@@ -668,7 +773,7 @@ bool MapData::readPaths(const VectorTile *tile, int zoom, QList<Path> *list)
 bool MapData::readPoints(const VectorTile *tile, int zoom, QList<Point> *list)
 {
 	const SubFileInfo &info = _subFiles.at(level(zoom));
-	SubFile subfile(_pointFile, info.offset, info.size);
+	SubFile subfile(_pointFile, info.offset, info.size, _map);
 	int rows = info.max - info.min + 1;
 	QVector<unsigned> points(rows);
 	quint32 val, unused, cnt = 0;
@@ -9,6 +9,8 @@
 #include "common/rtree.h"
 #include "common/range.h"
 #include "common/polygon.h"
+#include "map/cachebudget.h"
+#include "map/shardedcache.h"
 
 #define ID_NAME   1
 #define ID_HOUSE  2
@@ -19,7 +21,7 @@ namespace Mapsforge {
 
 class SubFile;
 
-class MapData
+class MapData : public CacheBudget::Client
 {
 public:
 	MapData(const QString &path);
@@ -68,6 +70,10 @@ public:
 	void load();
 	void clear();
 
+	void setCacheSize(int size);
+	qint64 cacheSize() const;
+	void trimCache(qint64 size);
+
 	bool isValid() const {return _valid;}
 	QString errorString() const {return _errorString;}
 
@@ -159,6 +165,7 @@ private:
 	friend HASH_T qHash(const MapData::Key &key);
 
 	QFile _pointFile, _pathFile;
+	uchar *_map;
 	RectC _bounds;
 	quint16 _tileSize;
 	QVector<SubFileInfo> _subFiles;
@@ -166,8 +173,12 @@ private:
 	QList<TileTree*> _tiles;
 	QHash<QByteArray, unsigned> _keys;
 
-	QCache<Key, QList<Path> > _pathCache;
-	QCache<Key, QList<Point> > _pointCache;
+	typedef ShardedCache<Key, QList<Path> > PathCache;
+	typedef ShardedCache<Key, QList<Point> > PointCache;
+
+	PathCache _pathCache;
+	PointCache _pointCache;
+	/* File access locks for the not memory mapped files */
 	QMutex _pathLock, _pointLock;
 
 	bool _valid;
@@ -100,7 +100,7 @@ static QPainterPath parallelPath(const QPainterPath &p, double dy)
 }
 
 void RasterTile::processPointLabels(const QList<MapData::Point> &points,
-  QList<TextItem*> &textItems)
+  TextItemGrid &textItems)
 {
 	QList<const Style::TextRender*> labels(_style->pointLabels(_zoom));
 	QList<const Style::Symbol*> symbols(_style->pointSymbols(_zoom));
@@ -152,7 +152,7 @@ void RasterTile::processPointLabels(const QList<MapData::Point> &points,
 	}
 }
 
-void RasterTile::processAreaLabels(QList<TextItem*> &textItems,
+void RasterTile::processAreaLabels(TextItemGrid &textItems,
   QVector<PainterPath> &paths)
 {
 	QList<const Style::TextRender*> labels(_style->areaLabels(_zoom));
@@ -204,7 +204,7 @@ void RasterTile::processAreaLabels(QList<TextItem*> &textItems,
 	}
 }
 
-void RasterTile::processLineLabels(QList<TextItem*> &textItems,
+void RasterTile::processLineLabels(TextItemGrid &textItems,
   QVector<PainterPath> &paths)
 {
 	QList<const Style::TextRender*> instructions(_style->pathLabels(_zoom));
@@ -394,14 +394,27 @@ void RasterTile::fetchData(QList<MapData::Path> &paths,
 	_data->points(pointRectD.toRectC(_proj, 20), _zoom, &points);
 }
 
+QString RasterTile::cacheKey() const
+{
+	return QString::number(_zoom) + QLatin1Char('-')
+	  + QString::number(_rect.x()) + QLatin1Char('-')
+	  + QString::number(_rect.y());
+}
+
 void RasterTile::render()
 {
+	if (_cache && _cache->find(cacheKey(), _pixmap)) {
+		_pixmap.setDevicePixelRatio(_ratio);
+		_valid = true;
+		return;
+	}
+
 	QList<MapData::Path> paths;
 	QList<MapData::Point> points;
 
 	fetchData(paths, points);
 
-	QList<TextItem*> textItems;
+	TextItemGrid textItems;
 	QVector<PainterPath> renderPaths(paths.size());
 
 	_pixmap.setDevicePixelRatio(_ratio);
@@ -416,13 +429,17 @@ void RasterTile::render()
 	processPointLabels(points, textItems);
 	processAreaLabels(textItems, renderPaths);
 	processLineLabels(textItems, renderPaths);
-	drawTextItems(&painter, textItems);
+	drawTextItems(&painter, textItems.items());
 
 	//painter.setPen(Qt::red);
 	//painter.setBrush(Qt::NoBrush);
 	//painter.drawRect(QRect(_rect.topLeft(), _pixmap.size()));
 
-	qDeleteAll(textItems);
+	qDeleteAll(textItems.items());
+	painter.end();
+
+	if (_cache)
+		_cache->insert(cacheKey(), _pixmap);
 
 	_valid = true;
 }
@@ -6,6 +6,8 @@
 #include "map/transform.h"
 #include "map/textpointitem.h"
 #include "map/textpathitem.h"
+#include "map/textitemgrid.h"
+#include "map/diskcache.h"
 #include "style.h"
 #include "mapdata.h"
 
@@ -16,9 +18,10 @@ class RasterTile
 public:
 	RasterTile(const Projection &proj, const Transform &transform,
 	  const Style *style, MapData *data, int zoom, const QRect &rect,
-	  qreal ratio) : _proj(proj), _transform(transform), _style(style),
-	  _data(data), _zoom(zoom), _rect(rect), _ratio(ratio),
-	  _pixmap(rect.width() * ratio, rect.height() * ratio), _valid(false) {}
+	  qreal ratio, const DiskCache *cache = 0) : _proj(proj),
+	  _transform(transform), _style(style), _data(data), _zoom(zoom),
+	  _rect(rect), _ratio(ratio), _pixmap(rect.width() * ratio,
+	  rect.height() * ratio), _cache(cache), _valid(false) {}
 
 	int zoom() const {return _zoom;}
 	QPoint xy() const {return _rect.topLeft();}
@@ -155,15 +158,16 @@ private:
 	QPointF ll2xy(const Coordinates &c) const
 	  {return _transform.proj2img(_proj.ll2xy(c));}
 	void processPointLabels(const QList<MapData::Point> &points,
-	  QList<TextItem*> &textItems);
-	void processAreaLabels(QList<TextItem*> &textItems,
+	  TextItemGrid &textItems);
+	void processAreaLabels(TextItemGrid &textItems,
 	  QVector<PainterPath> &paths);
-	void processLineLabels(QList<TextItem*> &textItems,
+	void processLineLabels(TextItemGrid &textItems,
 	  QVector<PainterPath> &paths);
 	QPainterPath painterPath(const Polygon &polygon, bool curve) const;
 	void drawTextItems(QPainter *painter, const QList<TextItem*> &textItems);
 	void drawPaths(QPainter *painter, const QList<MapData::Path> &paths,
 	  const QList<MapData::Point> &points, QVector<PainterPath> &painterPaths);
+	QString cacheKey() const;
 
 	Projection _proj;
 	Transform _transform;
@@ -173,6 +177,7 @@ private:
 	QRect _rect;
 	qreal _ratio;
 	QPixmap _pixmap;
+	const DiskCache *_cache;
 	bool _valid;
 };
 
@@ -8,6 +8,8 @@
 
 using namespace Mapsforge;
 
+#define MAX_INDEX_ZOOM 30
+
 static QString resourcePath(const QString &src, const QString &dir)
 {
 	QUrl url(src);
@@ -168,6 +170,79 @@ bool Style::Rule::match(int zoom, const QVector<MapData::Tag> &tags) const
 	return true;
 }
 
+bool Style::Rule::indexKeys(QList<unsigned> &keys) const
+{
+	const Filter *best = 0;
+
+	for (int i = 0; i < _filters.size(); i++) {
+		const Filter &filter = _filters.at(i);
+		if (filter.isNegation() || filter.keys().contains(0u))
+			continue;
+		/* None of the filter keys exist in the map */
+		if (filter.keys().isEmpty())
+			return false;
+		if (!best || filter.keys().size() < best->keys().size())
+			best = &filter;
+	}
+
+	keys = best ? best->keys() : QList<unsigned>();
+
+	return true;
+}
+
+void Style::RuleIndex::insert(int id, const Rule &rule)
+{
+	QList<unsigned> keys;
+
+	if (!rule.indexKeys(keys))
+		return;
+
+	int max = qMin(rule.zooms().max(), MAX_INDEX_ZOOM);
+	if (_levels.size() <= max)
+		_levels.resize(max + 1);
+
+	for (int zoom = qMax(rule.zooms().min(), 0); zoom <= max; zoom++) {
+		Level &level = _levels[zoom];
+
+		if (keys.isEmpty())
+			level.any.append(id);
+		else {
+			for (int i = 0; i < keys.size(); i++)
+				level.keys[keys.at(i)].append(id);
+		}
+	}
+}
+
+void Style::RuleIndex::candidates(int zoom, const QVector<MapData::Tag> &tags,
+  QVector<int> &list) const
+{
+	list.clear();
+
+	/* Zooms not covered by the index - all the rules are candidates */
+	if (zoom < 0 || zoom > MAX_INDEX_ZOOM) {
+		list.resize(_size);
+		for (int i = 0; i < _size; i++)
+			list[i] = i;
+		return;
+	}
+	if (zoom >= _levels.size())
+		return;
+
+	const Level &level = _levels.at(zoom);
+
+	list = level.any;
+	for (int i = 0; i < tags.size(); i++) {
+		QHash<unsigned, QVector<int> >::const_iterator it
+		  = level.keys.find(tags.at(i).key);
+		if (it != level.keys.constEnd())
+			list += it.value();
+	}
+
+	/* Keep the theme order of the rules */
+	std::sort(list.begin(), list.end());
+	list.erase(std::unique(list.begin(), list.end()), list.end());
+}
+
 void Style::area(QXmlStreamReader &reader, const QString &dir, qreal ratio,
   const Rule &rule)
 {
@@ -641,12 +716,17 @@ void Style::load(const MapData &data, qreal ratio)
 
 	if (!QFileInfo::exists(path) || !loadXml(path, data, ratio))
 		loadXml(":/mapsforge/default.xml", data, ratio);
+
+	_pathsIndex.build(_paths);
+	_circlesIndex.build(_circles);
 }
 
 void Style::clear()
 {
 	_paths.clear();
 	_circles.clear();
+	_pathsIndex.clear();
+	_circlesIndex.clear();
 	_pathLabels.clear();
 	_pointLabels.clear();
 	_areaLabels.clear();
@@ -657,10 +737,14 @@ QList<const Style::PathRender *> Style::paths(int zoom, bool closed,
   const QVector<MapData::Tag> &tags) const
 {
 	QList<const PathRender*> ri;
+	QVector<int> list;
 
-	for (int i = 0; i < _paths.size(); i++)
-		if (_paths.at(i).rule().match(zoom, closed, tags))
-			ri.append(&_paths.at(i));
+	_pathsIndex.candidates(zoom, tags, list);
+	for (int i = 0; i < list.size(); i++) {
+		const PathRender &path = _paths.at(list.at(i));
+		if (path.rule().match(zoom, closed, tags))
+			ri.append(&path);
+	}
 
 	return ri;
 }
@@ -669,10 +753,14 @@ QList<const Style::CircleRender *> Style::circles(int zoom,
   const QVector<MapData::Tag> &tags) const
 {
 	QList<const CircleRender*> ri;
+	QVector<int> list;
 
-	for (int i = 0; i < _circles.size(); i++)
-		if (_circles.at(i).rule().match(zoom, tags))
-			ri.append(&_circles.at(i));
+	_circlesIndex.candidates(zoom, tags, list);
+	for (int i = 0; i < list.size(); i++) {
+		const CircleRender &circle = _circles.at(list.at(i));
+		if (circle.rule().match(zoom, tags))
+			ri.append(&circle);
+	}
 
 	return ri;
 }
@@ -3,6 +3,7 @@
 
 #include <QString>
 #include <QList>
+#include <QHash>
 #include <QPen>
 #include <QFont>
 #include "mapdata.h"
@@ -24,6 +25,9 @@ public:
 		  const QVector<MapData::Tag> &tags) const;
 		bool match(int zoom, const QVector<MapData::Tag> &tags) const;
 
+		const Range &zooms() const {return _zooms;}
+		bool indexKeys(QList<unsigned> &keys) const;
+
 	private:
 		enum Type {
 			AnyType = 0,
@@ -55,6 +59,9 @@ public:
 					return (keyMatches(tags) && valueMatches(tags));
 			}
 
+			bool isNegation() const {return _neg;}
+			const QList<unsigned> &keys() const {return _keys;}
+
 			bool isTautology() const
 			{
 				return (!_neg && _keys.contains(0u) && _vals.contains(QByteArray()));
@@ -278,8 +285,43 @@ private:
 		QList<Layer> _layers;
 	};
 
+	/* Per-zoom rules index. The rules are indexed by the keys of their most
+	   selective key filter, so only the rules with at least one of the keys
+	   present in the tags must be matched. */
+	class RuleIndex
+	{
+	public:
+		RuleIndex() : _size(0) {}
+
+		template<class T>
+		void build(const QList<T> &renders)
+		{
+			clear();
+			_size = renders.size();
+			for (int i = 0; i < renders.size(); i++)
+				insert(i, renders.at(i).rule());
+		}
+		void clear() {_levels.clear(); _size = 0;}
+
+		void candidates(int zoom, const QVector<MapData::Tag> &tags,
+		  QVector<int> &list) const;
+
+	private:
+		struct Level
+		{
+			QHash<unsigned, QVector<int> > keys;
+			QVector<int> any;
+		};
+
+		void insert(int id, const Rule &rule);
+
+		QVector<Level> _levels;
+		int _size;
+	};
+
 	QList<PathRender> _paths;
 	QList<CircleRender> _circles;
+	RuleIndex _pathsIndex, _circlesIndex;
 	QList<TextRender> _pathLabels, _pointLabels, _areaLabels;
 	QList<Symbol> _symbols;
 
@@ -5,18 +5,32 @@ using namespace Mapsforge;
 
 #define mod2n(x, m) ((x) & ((m) - 1));
 
+#define MSB_MASK 0x8080808080808080ULL
+
+static inline qint32 vint1(quint8 b)
+{
+	return (b & 0x40) ? -(qint32)(b & 0x3F) : (qint32)(b & 0x3F);
+}
+
 bool SubFile::seek(quint64 pos)
 {
-	Q_ASSERT(pos < _size);
+	if (pos >= _size)
+		return false;
+
+	if (_mapped) {
+		_blockPos = pos;
+		_pos = pos;
+		return true;
+	}
 
 	int blockNum = pos >> BLOCK_BITS;
 
 	if (_blockNum != blockNum) {
 		quint64 seek = ((quint64)blockNum << BLOCK_BITS) + _offset;
 
-		if (seek >= _offset + _size || !_file.seek(seek))
+		if (!_file.seek(seek))
 			return false;
-		if (_file.read((char*)_data, sizeof(_data)) < 0)
+		if (_file.read((char*)_block, sizeof(_block)) < 0)
 			return false;
 		_blockNum = blockNum;
 	}
@@ -30,21 +44,79 @@ bool SubFile::seek(quint64 pos)
 bool SubFile::read(char *buff, quint32 size)
 {
 	while (size) {
-		quint32 remaining = sizeof(_data) - _blockPos;
-		if (size < remaining) {
-			memcpy(buff, _data + _blockPos, size);
-			_blockPos += size;
-			_pos += size;
-			return true;
-		} else {
-			memcpy(buff, _data + _blockPos, remaining);
-			buff += remaining;
-			size -= remaining;
-			_blockPos = 0;
-			_pos += remaining;
-			if (!seek(_pos))
+		if (_blockPos >= _blockSize && !seek(_pos))
+			return false;
+
+		quint32 len = (quint32)qMin((qint64)size, _blockSize - _blockPos);
+		memcpy(buff, _data + _blockPos, len);
+		buff += len;
+		size -= len;
+		skip(len);
+	}
+
+	return true;
+}
+
+bool SubFile::readVInt32(qint32 *vals, int count)
+{
+	int i = 0;
+
+	while (i < count) {
+		/* Slow path at the block/data boundaries */
+		if (_blockPos < 0 || _blockSize - _blockPos < 5) {
+			if (!readVInt32(vals[i++]))
 				return false;
+			continue;
 		}
+
+		/* Fast path - decode as many values as possible directly from the
+		   memory while at least one whole (5B max) varint is available */
+		const quint8 *start = _data + _blockPos;
+		const quint8 *end = _data + _blockSize - 5;
+		const quint8 *p = start;
+
+		while (i < count && p <= end) {
+			/* The most common case are single byte values (small coordinate
+			   deltas) - process them eight at once if possible */
+			if (count - i >= 8 && p + 8 <= end + 5) {
+				quint64 w;
+				memcpy(&w, p, sizeof(w));
+				if (!(w & MSB_MASK)) {
+					for (int j = 0; j < 8; j++)
+						vals[i + j] = vint1(p[j]);
+					p += 8;
+					i += 8;
+					continue;
+				}
+			}
+
+			quint8 b = *p++;
+			if (!(b & 0x80)) {
+				vals[i++] = vint1(b);
+				continue;
+			}
+
+			qint32 val = b & 0x7F;
+			int shift = 7;
+			for (int j = 1; j < 5; j++) {
+				b = *p++;
+				if (b & 0x80) {
+					val |= (qint32)(b & 0x7F) << shift;
+					shift += 7;
+				} else {
+					val |= (qint32)(b & 0x3F) << shift;
+					if (b & 0x40)
+						val = -val;
+					break;
+				}
+			}
+			if (b & 0x80)
+				return false;
+
+			vals[i++] = val;
+		}
+
+		skip(p - start);
 	}
 
 	return true;
@@ -10,20 +10,27 @@ namespace Mapsforge {
 class SubFile
 {
 public:
-	SubFile(QFile &file, quint64 offset, quint64 size)
-	  : _file(file), _offset(offset), _size(size), _pos(-1),
-	  _blockNum(-1), _blockPos(-1) {}
+	/* If map is set, the data is read directly from the memory mapped file,
+	   otherwise the file is read in BLOCK_BITS sized blocks. */
+	SubFile(QFile &file, quint64 offset, quint64 size, const uchar *map = 0)
+	  : _file(file), _data(map ? map + offset : _block), _offset(offset),
+	  _size(size), _pos(-1), _blockNum(-1), _blockPos(-1),
+	  _blockSize(map ? (qint64)size : (qint64)sizeof(_block)),
+	  _mapped(map != 0) {}
 
 	quint64 pos() const {return _pos;}
+	quint64 available() const {return (_pos < _size) ? _size - _pos : 0;}
 	bool seek(quint64 pos);
 
 	bool read(char *buff, quint32 size);
 
 	bool readByte(quint8 &val)
 	{
+		if (_blockPos >= _blockSize && !seek(_pos))
+			return false;
 		val = _data[_blockPos++];
 		_pos++;
-		return (_blockPos >= (int)sizeof(_data)) ? seek(_pos) : true;
+		return true;
 	}
 
 	template<typename T>
@@ -67,6 +74,25 @@ public:
 		int shift = 0;
 		quint8 b;
 
+		/* Fast path - the whole varint is available in the current block (or
+		   the mapped data) so it can be decoded directly from the memory. */
+		if (_blockPos >= 0 && _blockSize - _blockPos >= 5) {
+			const quint8 *p = _data + _blockPos;
+
+			val = 0;
+			for (int i = 0; i < 5; i++) {
+				b = p[i];
+				val |= (quint32)(b & 0x7F) << shift;
+				shift += 7;
+				if (!(b & 0x80)) {
+					skip(i + 1);
+					return true;
+				}
+			}
+
+			return false;
+		}
+
 		val = 0;
 		do {
 			if (!readByte(b))
@@ -83,6 +109,28 @@ public:
 		int shift = 0;
 		quint8 b;
 
+		/* Fast path, see readVUInt32() */
+		if (_blockPos >= 0 && _blockSize - _blockPos >= 5) {
+			const quint8 *p = _data + _blockPos;
+
+			val = 0;
+			for (int i = 0; i < 5; i++) {
+				b = p[i];
+				if (b & 0x80) {
+					val |= (qint32)(b & 0x7F) << shift;
+					shift += 7;
+				} else {
+					val |= (qint32)(b & 0x3F) << shift;
+					if (b & 0x40)
+						val = -val;
+					skip(i + 1);
+					return true;
+				}
+			}
+
+			return false;
+		}
+
 		val = 0;
 		while (true) {
 			if (!readByte(b))
@@ -101,6 +149,8 @@ public:
 		return true;
 	}
 
+	bool readVInt32(qint32 *vals, int count);
+
 	bool readString(QByteArray &str)
 	{
 		quint32 len;
@@ -116,13 +166,22 @@ public:
 	}
 
 private:
+	void skip(int bytes)
+	{
+		_blockPos += bytes;
+		_pos += bytes;
+	}
+
 	QFile &_file;
-	quint8 _data[1U<<BLOCK_BITS];
+	quint8 _block[1U<<BLOCK_BITS];
+	const quint8 *_data;
 	quint64 _offset;
 	quint64 _size;
 	qint64 _pos;
 	int _blockNum;
-	int _blockPos;
+	qint64 _blockPos;
+	qint64 _blockSize;
+	bool _mapped;
 };
 
 }
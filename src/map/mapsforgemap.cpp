@@ -1,7 +1,11 @@
 #include <QPainter>
 #include <QPixmapCache>
+#include <QtConcurrent>
+#include <QFileInfo>
+#include <QDir>
 #include "common/wgs84.h"
 #include "common/util.h"
+#include "common/programpaths.h"
 #include "rectd.h"
 #include "pcs.h"
 #include "mapsforgemap.h"
@@ -9,12 +13,18 @@
 
 using namespace Mapsforge;
 
+#define CACHE_DIR  "mapsforge"
+#define CACHE_SIZE 536870912 /* 512MB */
+
 MapsforgeMap::MapsforgeMap(const QString &fileName, QObject *parent)
   : Map(fileName, parent), _data(fileName), _zoom(0),
   _projection(PCS::pcs(3857)), _tileRatio(1.0)
 {
 	if (_data.isValid())
 		_zoom = _data.zooms().min();
+
+	connect(&_scheduler, &TileScheduler::finished, this,
+	  &MapsforgeMap::tilesLoaded);
 }
 
 void MapsforgeMap::load(const Projection &in, const Projection &out,
@@ -31,15 +41,54 @@ void MapsforgeMap::load(const Projection &in, const Projection &out,
 
 	updateTransform();
 
+	_cache = DiskCache(QDir(ProgramPaths::tilesDir()).filePath(CACHE_DIR),
+	  cacheId(), CACHE_SIZE);
+	_cache.trim();
+
 	QPixmapCache::clear();
 }
 
 void MapsforgeMap::unload()
 {
-	cancelJobs(true);
+	_scheduler.cancel(true);
 
 	_data.clear();
 	_style.clear();
+	_cache = DiskCache();
+}
+
+void MapsforgeMap::clearCache()
+{
+	_scheduler.cancel(true);
+
+	_cache.clear();
+	QPixmapCache::clear();
+}
+
+QByteArray MapsforgeMap::cacheId() const
+{
+	/* The rendered tiles depend on the map file, the render theme, the device
+	   ratio and the output projection (represented by the projected map
+	   bounds). The zoom and the tile position are part of the tile key. */
+	QFileInfo mi(path());
+	QFileInfo ti(ProgramPaths::renderthemeFile());
+	RectD prect(_data.bounds(), _projection);
+	QByteArray id;
+
+	id.append(mi.absoluteFilePath().toUtf8());
+	id.append(QByteArray::number(mi.size()));
+	id.append(QByteArray::number(mi.lastModified().toMSecsSinceEpoch()));
+	if (ti.exists()) {
+		id.append(ti.absoluteFilePath().toUtf8());
+		id.append(QByteArray::number(ti.lastModified().toMSecsSinceEpoch()));
+	}
+	id.append(QByteArray::number(_tileRatio));
+	id.append(QByteArray::number(prect.left(), 'g', 12));
+	id.append(QByteArray::number(prect.top(), 'g', 12));
+	id.append(QByteArray::number(prect.right(), 'g', 12));
+	id.append(QByteArray::number(prect.bottom(), 'g', 12));
+
+	return id;
 }
 
 int MapsforgeMap::zoomFit(const QSize &size, const RectC &rect)
@@ -65,7 +114,7 @@ int MapsforgeMap::zoomFit(const QSize &size, const RectC &rect)
 
 int MapsforgeMap::zoomIn()
 {
-	cancelJobs(false);
+	_scheduler.cancel(QRectF());
 
 	_zoom = qMin(_zoom + 1, _data.zooms().max());
 	updateTransform();
@@ -74,7 +123,7 @@ int MapsforgeMap::zoomIn()
 
 int MapsforgeMap::zoomOut()
 {
-	cancelJobs(false);
+	_scheduler.cancel(QRectF());
 
 	_zoom = qMax(_zoom - 1, _data.zooms().min());
 	updateTransform();
@@ -116,55 +165,6 @@ QString MapsforgeMap::key(int zoom, const QPoint &xy) const
 	  + QString::number(xy.x()) + "_" + QString::number(xy.y());
 }
 
-bool MapsforgeMap::isRunning(int zoom, const QPoint &xy) const
-{
-	for (int i = 0; i < _jobs.size(); i++) {
-		const QList<Mapsforge::RasterTile> &tiles = _jobs.at(i)->tiles();
-		for (int j = 0; j < tiles.size(); j++) {
-			const Mapsforge::RasterTile &mt = tiles.at(j);
-			if (mt.zoom() == zoom && mt.xy() == xy)
-				return true;
-		}
-	}
-
-	return false;
-}
-
-void MapsforgeMap::runJob(MapsforgeMapJob *job)
-{
-	_jobs.append(job);
-
-	connect(job, &MapsforgeMapJob::finished, this, &MapsforgeMap::jobFinished);
-	job->run();
-}
-
-void MapsforgeMap::removeJob(MapsforgeMapJob *job)
-{
-	_jobs.removeOne(job);
-	job->deleteLater();
-}
-
-void MapsforgeMap::jobFinished(MapsforgeMapJob *job)
-{
-	const QList<Mapsforge::RasterTile> &tiles = job->tiles();
-
-	for (int i = 0; i < tiles.size(); i++) {
-		const Mapsforge::RasterTile &mt = tiles.at(i);
-		if (mt.isValid())
-			QPixmapCache::insert(key(mt.zoom(), mt.xy()), mt.pixmap());
-	}
-
-	removeJob(job);
-
-	emit tilesLoaded();
-}
-
-void MapsforgeMap::cancelJobs(bool wait)
-{
-	for (int i = 0; i < _jobs.size(); i++)
-		_jobs.at(i)->cancel(wait);
-}
-
 void MapsforgeMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
 	QPointF tl(floor(rect.left() / _data.tileSize()) * _data.tileSize(),
@@ -179,16 +179,17 @@ void MapsforgeMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 		for (int j = 0; j < height; j++) {
 			QPoint ttl(tl.x() + i * _data.tileSize(), tl.y() + j
 			  * _data.tileSize());
-			if (isRunning(_zoom, ttl))
+			QString tk(key(_zoom, ttl));
+			if (_scheduler.isRunning(tk))
 				continue;
 
 			QPixmap pm;
-			if (QPixmapCache::find(key(_zoom, ttl), &pm))
+			if (QPixmapCache::find(tk, &pm))
 				painter->drawPixmap(ttl, pm);
 			else {
 				tiles.append(RasterTile(_projection, _transform, &_style, &_data,
 				  _zoom, QRect(ttl, QSize(_data.tileSize(), _data.tileSize())),
-				  _tileRatio));
+				  _tileRatio, &_cache));
 			}
 		}
 	}
@@ -204,11 +205,58 @@ void MapsforgeMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 				painter->drawPixmap(mt.xy(), pm);
 				QPixmapCache::insert(key(mt.zoom(), mt.xy()), pm);
 			}
-		} else
-			runJob(new MapsforgeMapJob(tiles));
+		} else {
+			for (int i = 0; i < tiles.size(); i++) {
+				const RasterTile &mt = tiles.at(i);
+				_scheduler.render(mt, key(mt.zoom(), mt.xy()), QRect(mt.xy(),
+				  QSize(_data.tileSize(), _data.tileSize())), rect.center());
+			}
+		}
 	}
 }
 
+void MapsforgeMap::prefetch(const QRectF &rect, int budget)
+{
+	int ts = _data.tileSize();
+	QRect tiles(QPoint(floor(rect.left() / ts), floor(rect.top() / ts)),
+	  QPoint(ceil(rect.right() / ts) - 1, ceil(rect.bottom() / ts) - 1));
+
+	_scheduler.cancelPrefetch();
+
+	budget -= prefetch(_zoom, prefetchTiles(tiles.adjusted(-1, -1, 1, 1),
+	  tiles), budget);
+	if (_zoom > _data.zooms().min())
+		budget -= prefetch(_zoom - 1, prefetchTiles(zoomTiles(tiles, -1)),
+		  budget);
+	if (_zoom < _data.zooms().max())
+		prefetch(_zoom + 1, prefetchTiles(zoomTiles(tiles, 1)), budget);
+}
+
+int MapsforgeMap::prefetch(int zoom, const QVector<QPoint> &tiles, int budget)
+{
+	int ts = _data.tileSize();
+	Transform t(transform(zoom));
+	RectD prect(_data.bounds(), _projection);
+	QRectF bounds(t.proj2img(prect.topLeft()), t.proj2img(prect.bottomRight()));
+	int cnt = 0;
+
+	for (int i = 0; i < tiles.size() && cnt < budget; i++) {
+		QRect tr(tiles.at(i) * ts, QSize(ts, ts));
+		QString tk(key(zoom, tr.topLeft()));
+		QPixmap pm;
+
+		if (!bounds.intersects(tr) || _scheduler.isPending(tk)
+		  || QPixmapCache::find(tk, &pm))
+			continue;
+
+		_scheduler.prefetch(RasterTile(_projection, t, &_style, &_data, zoom,
+		  tr, _tileRatio, &_cache), tk, tr);
+		cnt++;
+	}
+
+	return cnt;
+}
+
 Map *MapsforgeMap::create(const QString &path, bool *isMap)
 {
 	if (isMap)
@@ -1,49 +1,15 @@
 #ifndef MAPSFORGEMAP_H
 #define MAPSFORGEMAP_H
 
-#include <QtConcurrent>
 #include "mapsforge/mapdata.h"
 #include "mapsforge/rastertile.h"
 #include "projection.h"
 #include "transform.h"
+#include "diskcache.h"
+#include "tilescheduler.h"
 #include "map.h"
 
 
-class MapsforgeMapJob : public QObject
-{
-	Q_OBJECT
-
-public:
-	MapsforgeMapJob(const QList<Mapsforge::RasterTile> &tiles)
-	  : _tiles(tiles) {}
-
-	void run()
-	{
-		connect(&_watcher, &QFutureWatcher<void>::finished, this,
-		  &MapsforgeMapJob::handleFinished);
-		_future = QtConcurrent::map(_tiles, &Mapsforge::RasterTile::render);
-		_watcher.setFuture(_future);
-	}
-	void cancel(bool wait)
-	{
-		_future.cancel();
-		if (wait)
-			_future.waitForFinished();
-	}
-	const QList<Mapsforge::RasterTile> &tiles() const {return _tiles;}
-
-signals:
-	void finished(MapsforgeMapJob *job);
-
-private slots:
-	void handleFinished() {emit finished(this);}
-
-private:
-	QFutureWatcher<void> _watcher;
-	QFuture<void> _future;
-	QList<Mapsforge::RasterTile> _tiles;
-};
-
 class MapsforgeMap : public Map
 {
 	Q_OBJECT
@@ -70,23 +36,22 @@ public:
 	  {return _projection.xy2ll(_transform.img2proj(p));}
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void prefetch(const QRectF &rect, int budget);
+	void cancel(const QRectF &rect) {_scheduler.cancel(rect);}
+
+	void clearCache();
 
 	bool isValid() const {return _data.isValid();}
 	QString errorString() const {return _data.errorString();}
 
 	static Map *create(const QString &path, bool *isMap);
 
-private slots:
-	void jobFinished(MapsforgeMapJob *job);
-
 private:
 	QString key(int zoom, const QPoint &xy) const;
 	Transform transform(int zoom) const;
 	void updateTransform();
-	bool isRunning(int zoom, const QPoint &xy) const;
-	void runJob(MapsforgeMapJob *job);
-	void removeJob(MapsforgeMapJob *job);
-	void cancelJobs(bool wait);
+	QByteArray cacheId() const;
+	int prefetch(int zoom, const QVector<QPoint> &tiles, int budget);
 
 	Mapsforge::MapData _data;
 	Mapsforge::Style _style;
@@ -96,8 +61,9 @@ private:
 	Transform _transform;
 	QRectF _bounds;
 	qreal _tileRatio;
+	DiskCache _cache;
 
-	QList<MapsforgeMapJob*> _jobs;
+	TileScheduler _scheduler;
 };
 
 #endif // MAPSFORGEMAP_H
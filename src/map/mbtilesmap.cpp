@@ -13,6 +13,8 @@
 
 
 #define META_TYPE(type) static_cast<QMetaType::Type>(type)
+#define TILE_QUERY "SELECT tile_data FROM tiles " \
+  "WHERE zoom_level=:zoom AND tile_column=:x AND tile_row=:y"
 
 class MBTile
 {
@@ -24,8 +26,9 @@ public:
 	const QPoint &xy() const {return _xy;}
 	const QString &key() const {return _key;}
 	QPixmap pixmap() const {return QPixmap::fromImage(_image);}
+	bool isValid() const {return !_image.isNull();}
 
-	void load() {
+	void render() {
 		QByteArray z(QString::number(_zoom).toLatin1());
 
 		QBuffer buffer(&_data);
@@ -162,6 +165,9 @@ MBTilesMap::MBTilesMap(const QString &fileName, QObject *parent)
 
 	_db.close();
 
+	connect(&_scheduler, &TileScheduler::finished, this,
+	  &MBTilesMap::tilesLoaded);
+
 	_valid = true;
 }
 
@@ -247,8 +253,13 @@ qreal MBTilesMap::tileSize() const
 QByteArray MBTilesMap::tileData(int zoom, const QPoint &tile) const
 {
 	QSqlQuery query(_db);
-	query.prepare("SELECT tile_data FROM tiles "
-	  "WHERE zoom_level=:zoom AND tile_column=:x AND tile_row=:y");
+	query.prepare(TILE_QUERY);
+	return tileData(query, zoom, tile);
+}
+
+QByteArray MBTilesMap::tileData(QSqlQuery &query, int zoom,
+  const QPoint &tile) const
+{
 	query.bindValue(":zoom", zoom);
 	query.bindValue(":x", tile.x());
 	query.bindValue(":y", (1<<zoom) - tile.y() - 1);
@@ -260,9 +271,14 @@ QByteArray MBTilesMap::tileData(int zoom, const QPoint &tile) const
 	return QByteArray();
 }
 
+QString MBTilesMap::key(int zoom, const QPoint &tile) const
+{
+	return path() + "-" + QString::number(zoom) + "_"
+	  + QString::number(tile.x()) + "_" + QString::number(tile.y());
+}
+
 void MBTilesMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
-	Q_UNUSED(flags);
 	int zoom = _zooms.at(_zi);
 	qreal scale = OSM::zoom2scale(zoom, _tileSize);
 	QRectF b(bounds());
@@ -285,22 +301,26 @@ void MBTilesMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 		for (int j = 0; j < height; j++) {
 			QPixmap pm;
 			QPoint t(tile.x() + i, tile.y() + j);
-			QString key = path() + "-" + QString::number(zoom) + "_"
-			  + QString::number(t.x()) + "_" + QString::number(t.y());
+			QString tk(key(zoom, t));
+
+			/* Tiles that are already being prefetched are not read and
+			   decoded once again, they are drawn when they finish */
+			if (!(flags & Map::Block) && _scheduler.promote(tk, rect.center()))
+				continue;
 
-			if (QPixmapCache::find(key, &pm)) {
+			if (QPixmapCache::find(tk, &pm)) {
 				QPointF tp(qMax(tl.x(), b.left()) + (t.x() - tile.x())
 				  * tileSize(), qMax(tl.y(), b.top()) + (t.y() - tile.y())
 				  * tileSize());
 				drawTile(painter, pm, tp);
 			} else {
 				tiles.append(MBTile(zoom, _scaledSize, t, tileData(zoom, t),
-				  key));
+				  tk));
 			}
 		}
 	}
 
-	QFuture<void> future = QtConcurrent::map(tiles, &MBTile::load);
+	QFuture<void> future = QtConcurrent::map(tiles, &MBTile::render);
 	future.waitForFinished();
 
 	for (int i = 0; i < tiles.size(); i++) {
@@ -318,6 +338,64 @@ void MBTilesMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 	}
 }
 
+void MBTilesMap::prefetch(const QRectF &rect, int budget)
+{
+	int zoom = _zooms.at(_zi);
+	qreal scale = OSM::zoom2scale(zoom, _tileSize);
+	QRect tiles(OSM::mercator2tile(QPointF(rect.left() * scale,
+	  -rect.top() * scale) * coordinatesRatio(), zoom),
+	  OSM::mercator2tile(QPointF(rect.right() * scale, -rect.bottom() * scale)
+	  * coordinatesRatio(), zoom));
+
+	_scheduler.cancelPrefetch();
+
+	budget -= prefetch(zoom, prefetchTiles(tiles.adjusted(-1, -1, 1, 1),
+	  tiles), budget);
+	if (_zi > 0) {
+		int z = _zooms.at(_zi - 1);
+		budget -= prefetch(z, prefetchTiles(zoomTiles(tiles, z - zoom)),
+		  budget);
+	}
+	if (_zi < _zooms.size() - 1) {
+		int z = _zooms.at(_zi + 1);
+		prefetch(z, prefetchTiles(zoomTiles(tiles, z - zoom)), budget);
+	}
+}
+
+int MBTilesMap::prefetch(int zoom, const QVector<QPoint> &tiles, int budget)
+{
+	QRect bounds(OSM::ll2tile(_bounds.topLeft(), zoom),
+	  OSM::ll2tile(_bounds.bottomRight(), zoom));
+	QSqlQuery query(_db);
+	int cnt = 0;
+
+	query.prepare(TILE_QUERY);
+
+	for (int i = 0; i < tiles.size() && cnt < budget; i++) {
+		const QPoint &t = tiles.at(i);
+		if (!bounds.contains(t))
+			continue;
+
+		QString tk(key(zoom, t));
+		QPixmap pm;
+		if (_scheduler.isPending(tk) || QPixmapCache::find(tk, &pm))
+			continue;
+
+		/* Only the image decoding runs in the background, the database is
+		   accessed from the thread owning the connection. The budget limits
+		   the database reads, including the missing tiles. */
+		QByteArray data(tileData(query, zoom, t));
+		cnt++;
+		if (data.isNull())
+			continue;
+
+		_scheduler.prefetch(MBTile(zoom, _scaledSize, t, data, tk), tk,
+		  QRect());
+	}
+
+	return cnt;
+}
+
 void MBTilesMap::drawTile(QPainter *painter, QPixmap &pixmap, QPointF &tp)
 {
 	pixmap.setDevicePixelRatio(imageRatio());
@@ -3,8 +3,11 @@
 
 #include <QSqlDatabase>
 #include <QVector>
+#include "tilescheduler.h"
 #include "map.h"
 
+class QSqlQuery;
+
 class MBTilesMap : public Map
 {
 public:
@@ -26,6 +29,8 @@ public:
 	Coordinates xy2ll(const QPointF &p);
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void prefetch(const QRectF &rect, int budget);
+	void cancel(const QRectF &rect) {_scheduler.cancel(rect);}
 
 	void load(const Projection &in, const Projection &out, qreal deviceRatio,
 	  bool hidpi);
@@ -41,7 +46,10 @@ private:
 	qreal coordinatesRatio() const;
 	qreal imageRatio() const;
 	QByteArray tileData(int zoom, const QPoint &tile) const;
+	QByteArray tileData(QSqlQuery &query, int zoom, const QPoint &tile) const;
+	QString key(int zoom, const QPoint &tile) const;
 	void drawTile(QPainter *painter, QPixmap &pixmap, QPointF &tp);
+	int prefetch(int zoom, const QVector<QPoint> &tiles, int budget);
 
 	QSqlDatabase _db;
 
@@ -54,6 +62,8 @@ private:
 	bool _scalable;
 	int _scaledSize;
 
+	TileScheduler _scheduler;
+
 	bool _valid;
 	QString _errorString;
 };
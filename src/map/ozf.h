@@ -7,7 +7,7 @@
 #include <QList>
 #include <QVector>
 #include <QFile>
-#include <QPixmap>
+#include <QImage>
 
 class OZF
 {
@@ -25,7 +25,8 @@ public:
 	QSize size(int zoom) const;
 	QPointF scale(int zoom) const;
 	QSize tileSize() const {return QSize(_tileSize, _tileSize);}
-	QPixmap tile(int zoom, int x, int y);
+	QByteArray tileData(int zoom, int x, int y);
+	QImage tileImage(int zoom, const QByteArray &data) const;
 
 	static bool isOZF(const QString &path);
 
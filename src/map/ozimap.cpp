@@ -6,6 +6,7 @@
 #include <QImageReader>
 #include <QPixmapCache>
 #include <QRegularExpression>
+#include <QtConcurrent>
 #include "common/coordinates.h"
 #include "common/rectc.h"
 #include "tar.h"
@@ -13,6 +14,7 @@
 #include "image.h"
 #include "mapfile.h"
 #include "rectd.h"
+#include "tile.h"
 #include "ozimap.h"
 
 
@@ -76,6 +78,9 @@ OziMap::OziMap(const QString &fileName, bool TAR, QObject *parent)
 		}
 	}
 
+	connect(&_scheduler, &TileScheduler::finished, this,
+	  &OziMap::tilesLoaded);
+
 	_valid = true;
 }
 
@@ -117,11 +122,17 @@ OziMap::OziMap(const QString &fileName, Tar &tar, QObject *parent)
 	}
 	_tar->close();
 
+	connect(&_scheduler, &TileScheduler::finished, this,
+	  &OziMap::tilesLoaded);
+
 	_valid = true;
 }
 
 OziMap::~OziMap()
 {
+	/* The OZF tiles decoding uses the OZF file object */
+	_scheduler.cancel(true);
+
 	delete _img;
 	delete _tar;
 	delete _ozf;
@@ -226,13 +237,15 @@ void OziMap::load(const Projection &in, const Projection &out,
 	if (!_tile.isValid() && !_ozf) {
 		Q_ASSERT(!_img);
 		_img = new Image(_map.path);
-		if (_img)
-			_img->setDevicePixelRatio(_mapRatio);
+		_img->setDevicePixelRatio(_mapRatio);
+		connect(_img, &Image::tilesLoaded, this, &OziMap::tilesLoaded);
 	}
 }
 
 void OziMap::unload()
 {
+	_scheduler.cancel(true);
+
 	delete _img;
 	_img = 0;
 
@@ -243,11 +256,37 @@ void OziMap::unload()
 		_ozf->close();
 }
 
-void OziMap::drawTiled(QPainter *painter, const QRectF &rect) const
+class OZFTile
+{
+public:
+	OZFTile(const OZF *ozf, int zoom, const QPoint &xy, const QByteArray &data,
+	  const QString &key) : _ozf(ozf), _zoom(zoom), _xy(xy), _data(data),
+	  _key(key) {}
+
+	const QPoint &xy() const {return _xy;}
+	const QString &key() const {return _key;}
+	const QImage &image() const {return _image;}
+
+	QPixmap pixmap() const {return QPixmap::fromImage(_image);}
+	bool isValid() const {return !_image.isNull();}
+
+	void render() {_image = _ozf->tileImage(_zoom, _data);}
+
+private:
+	const OZF *_ozf;
+	int _zoom;
+	QPoint _xy;
+	QByteArray _data;
+	QString _key;
+	QImage _image;
+};
+
+void OziMap::drawTiled(QPainter *painter, const QRectF &rect, Flags flags)
 {
 	QSizeF ts(_tile.size.width() / _mapRatio, _tile.size.height() / _mapRatio);
 	QPointF tl(floor(rect.left() / ts.width()) * ts.width(),
 	  floor(rect.top() / ts.height()) * ts.height());
+	QList<RenderTile> tiles;
 
 	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
 	for (int i = 0; i < ceil(s.width() / ts.width()); i++) {
@@ -257,37 +296,64 @@ void OziMap::drawTiled(QPainter *painter, const QRectF &rect) const
 
 			QString tileName(_tile.path.arg(QString::number(x),
 			  QString::number(y)));
+			QString key = _tar ? _tar->fileName() + "/" + tileName : tileName;
+			QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
 			QPixmap pixmap;
 
-			if (_tar) {
-				QString key = _tar->fileName() + "/" + tileName;
-				if (!QPixmapCache::find(key, &pixmap)) {
-					QByteArray ba = _tar->file(tileName);
-					pixmap = QPixmap::fromImage(QImage::fromData(ba));
-					if (!pixmap.isNull())
-						QPixmapCache::insert(key, pixmap);
-				}
-			} else
-				pixmap = QPixmap(tileName);
-
-			if (pixmap.isNull())
-				qWarning("%s: error loading tile image", qPrintable(
-				  _tile.path.arg(QString::number(x), QString::number(y))));
-			else {
+			if (QPixmapCache::find(key, &pixmap)) {
 				pixmap.setDevicePixelRatio(_mapRatio);
-				QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
 				painter->drawPixmap(tp, pixmap);
+			} else if (!(flags & Map::Block)
+			  && _scheduler.promote(key, rect.center()))
+				continue;
+			else {
+				QByteArray ba;
+				if (_tar)
+					ba = _tar->file(tileName);
+				else {
+					QFile file(tileName);
+					if (file.open(QIODevice::ReadOnly))
+						ba = file.readAll();
+				}
+
+				RenderTile t(QPoint(i, j), ba, key);
+				if (flags & Map::Block)
+					tiles.append(t);
+				else
+					_scheduler.render(t, key, QRectF(tp, ts).toRect(),
+					  rect.center());
 			}
 		}
 	}
+
+	/* The tiles are read sequentially and decoded in parallel, in the
+	   background unless the drawing must block (printing) */
+	QFuture<void> future = QtConcurrent::map(tiles, &RenderTile::load);
+	future.waitForFinished();
+
+	for (int i = 0; i < tiles.size(); i++) {
+		const RenderTile &mt = tiles.at(i);
+		QPixmap pm(mt.pixmap());
+
+		if (pm.isNull())
+			qWarning("%s: error loading tile image", qPrintable(mt.key()));
+		else {
+			QPixmapCache::insert(mt.key(), pm);
+			pm.setDevicePixelRatio(_mapRatio);
+			QPointF tp(tl.x() + mt.xy().x() * ts.width(), tl.y() + mt.xy().y()
+			  * ts.height());
+			painter->drawPixmap(tp, pm);
+		}
+	}
 }
 
-void OziMap::drawOZF(QPainter *painter, const QRectF &rect) const
+void OziMap::drawOZF(QPainter *painter, const QRectF &rect, Flags flags)
 {
 	QSizeF ts(_ozf->tileSize().width() / _mapRatio, _ozf->tileSize().height()
 	  / _mapRatio);
 	QPointF tl(floor(rect.left() / ts.width()) * ts.width(),
 	  floor(rect.top() / ts.height()) * ts.height());
+	QList<OZFTile> tiles;
 
 	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
 	for (int i = 0; i < ceil(s.width() / ts.width()); i++) {
@@ -298,33 +364,57 @@ void OziMap::drawOZF(QPainter *painter, const QRectF &rect) const
 			QPixmap pixmap;
 			QString key = _ozf->fileName() + "/" + QString::number(_zoom) + "_"
 			  + QString::number(x) + "_" + QString::number(y);
-			if (!QPixmapCache::find(key, &pixmap)) {
-				pixmap = _ozf->tile(_zoom, x, y);
-				if (!pixmap.isNull())
-					QPixmapCache::insert(key, pixmap);
-			}
 
-			if (pixmap.isNull())
-				qWarning("%s: error loading tile image", qPrintable(key));
-			else {
+			QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
+
+			if (QPixmapCache::find(key, &pixmap)) {
 				pixmap.setDevicePixelRatio(_mapRatio);
-				QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
 				painter->drawPixmap(tp, pixmap);
+			} else if (!(flags & Map::Block)
+			  && _scheduler.promote(key, rect.center()))
+				continue;
+			else {
+				OZFTile t(_ozf, _zoom, QPoint(i, j), _ozf->tileData(_zoom, x, y),
+				  key);
+				if (flags & Map::Block)
+					tiles.append(t);
+				else
+					_scheduler.render(t, key, QRectF(tp, ts).toRect(),
+					  rect.center());
 			}
 		}
 	}
+
+	/* The (possibly encrypted) tile data is read sequentially, the
+	   decompression runs in parallel, in the background unless the drawing
+	   must block (printing) */
+	QFuture<void> future = QtConcurrent::map(tiles, &OZFTile::render);
+	future.waitForFinished();
+
+	for (int i = 0; i < tiles.size(); i++) {
+		const OZFTile &mt = tiles.at(i);
+		QPixmap pm(QPixmap::fromImage(mt.image()));
+
+		if (pm.isNull())
+			qWarning("%s: error loading tile image", qPrintable(mt.key()));
+		else {
+			QPixmapCache::insert(mt.key(), pm);
+			pm.setDevicePixelRatio(_mapRatio);
+			QPointF tp(tl.x() + mt.xy().x() * ts.width(), tl.y() + mt.xy().y()
+			  * ts.height());
+			painter->drawPixmap(tp, pm);
+		}
+	}
 }
 
 void OziMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
-	Q_UNUSED(flags);
-
 	if (_ozf)
-		drawOZF(painter, rect);
+		drawOZF(painter, rect, flags);
 	else if (_img)
 		_img->draw(painter, rect, flags);
 	else if (_tile.isValid())
-		drawTiled(painter, rect);
+		drawTiled(painter, rect, flags);
 }
 
 QPointF OziMap::ll2xy(const Coordinates &c)
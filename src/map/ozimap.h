@@ -3,6 +3,7 @@
 
 #include "transform.h"
 #include "projection.h"
+#include "tilescheduler.h"
 #include "map.h"
 
 class Tar;
@@ -32,6 +33,7 @@ public:
 	Coordinates xy2ll(const QPointF &p);
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void cancel(const QRectF &rect) {_scheduler.cancel(rect);}
 
 	void load(const Projection &in, const Projection &out, qreal deviceRatio,
 	  bool hidpi);
@@ -61,8 +63,8 @@ private:
 	bool setTileInfo(const QStringList &tiles, const QString &path = QString());
 	bool setImageInfo(const QString &path);
 
-	void drawTiled(QPainter *painter, const QRectF &rect) const;
-	void drawOZF(QPainter *painter, const QRectF &rect) const;
+	void drawTiled(QPainter *painter, const QRectF &rect, Flags flags);
+	void drawOZF(QPainter *painter, const QRectF &rect, Flags flags);
 	void drawImage(QPainter *painter, const QRectF &rect, Flags flags) const;
 
 	void rescale(int zoom);
@@ -80,6 +82,8 @@ private:
 
 	bool _valid;
 	QString _errorString;
+
+	TileScheduler _scheduler;
 };
 
 #endif // OZIMAP_H
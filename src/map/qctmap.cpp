@@ -1,7 +1,9 @@
 #include <cstring>
+#include <algorithm>
 #include <QDataStream>
 #include <QPixmapCache>
 #include <QPainter>
+#include <QtConcurrent>
 #include "common/util.h"
 #include "common/color.h"
 #include "qctmap.h"
@@ -318,8 +320,24 @@ bool QCTMap::readIndex(QDataStream &stream)
 	_index.resize(_cols * _rows);
 	for (int i = 0; i < _cols * _rows; i++)
 		stream >> _index[i];
+	if (stream.status() != QDataStream::Ok)
+		return false;
 
-	return (stream.status() == QDataStream::Ok);
+	/* The tile data size is not stored in the file, the tile data is bounded
+	   by the next tile in the file (or the end of the file) */
+	QVector<quint32> sorted(_index);
+	std::sort(sorted.begin(), sorted.end());
+	quint32 end = (quint32)stream.device()->size();
+
+	_sizes.resize(_index.size());
+	for (int i = 0; i < _index.size(); i++) {
+		QVector<quint32>::const_iterator it = std::upper_bound(
+		  sorted.constBegin(), sorted.constEnd(), _index.at(i));
+		quint32 next = (it == sorted.constEnd()) ? end : *it;
+		_sizes[i] = (next > _index.at(i)) ? next - _index.at(i) : 0;
+	}
+
+	return true;
 }
 
 QCTMap::QCTMap(const QString &fileName, QObject *parent)
@@ -351,6 +369,9 @@ QCTMap::QCTMap(const QString &fileName, QObject *parent)
 
 	_file.close();
 
+	connect(&_scheduler, &TileScheduler::finished, this,
+	  &QCTMap::tilesLoaded);
+
 	_valid = true;
 }
 
@@ -366,6 +387,7 @@ void QCTMap::load(const Projection &in, const Projection &out,
 
 void QCTMap::unload()
 {
+	_scheduler.cancel(true);
 	_file.close();
 }
 
@@ -413,7 +435,7 @@ Coordinates QCTMap::xy2ll(const QPointF &p)
 	return Coordinates(lon + _shiftE, lat + _shiftN);
 }
 
-QPixmap QCTMap::tile(int x, int y)
+static QImage tileImage(const QByteArray &data, const QVector<QRgb> &palette)
 {
 	static quint8 rowSeq[] = {
 		 0, 32, 16, 48,  8, 40, 24, 56,  4, 36, 20, 52, 12, 44, 28, 60,
@@ -426,15 +448,12 @@ QPixmap QCTMap::tile(int x, int y)
 	bool ret;
 
 
-	if (!_file.seek(_index.at(y * _cols + x)))
-		return QPixmap();
-
-	QDataStream stream(&_file);
+	QDataStream stream(data);
 	stream.setByteOrder(QDataStream::LittleEndian);
 
 	stream >> packing;
 	if (stream.status() != QDataStream::Ok)
-		return QPixmap();
+		return QImage();
 
 	if (packing == 0 || packing == 255)
 		ret = huffman(stream, tileData);
@@ -444,7 +463,7 @@ QPixmap QCTMap::tile(int x, int y)
 		ret = rle(stream, tileData, packing);
 
 	if (!ret)
-		return QPixmap();
+		return QImage();
 
 	for (int i = 0; i < TILE_SIZE; i++)
 		memcpy(imgData + i * TILE_SIZE, tileData + rowSeq[i] * TILE_SIZE,
@@ -452,18 +471,52 @@ QPixmap QCTMap::tile(int x, int y)
 
 	QImage img(imgData, TILE_SIZE, TILE_SIZE, TILE_SIZE,
 	  QImage::Format_Indexed8);
-	img.setColorTable(_palette);
+	img.setColorTable(palette);
 
-	return QPixmap::fromImage(img);
+	return img.copy();
 }
 
-void QCTMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
+class QCTTile
 {
-	Q_UNUSED(flags);
+public:
+	QCTTile(const QPoint &xy, const QByteArray &data,
+	  const QVector<QRgb> &palette, const QString &key)
+	  : _xy(xy), _data(data), _palette(palette), _key(key) {}
+
+	const QPoint &xy() const {return _xy;}
+	const QString &key() const {return _key;}
+	const QImage &image() const {return _image;}
+	QPixmap pixmap() const {return QPixmap::fromImage(_image);}
+	bool isValid() const {return !_image.isNull();}
+
+	void render() {_image = tileImage(_data, _palette);}
+
+private:
+	QPoint _xy;
+	QByteArray _data;
+	QVector<QRgb> _palette;
+	QString _key;
+	QImage _image;
+};
+
+QByteArray QCTMap::tileData(int x, int y)
+{
+	if (x < 0 || y < 0 || x >= _cols || y >= _rows)
+		return QByteArray();
+
+	int i = y * _cols + x;
+	if (!_file.seek(_index.at(i)))
+		return QByteArray();
+
+	return _file.read(_sizes.at(i));
+}
 
+void QCTMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
+{
 	QSizeF ts(TILE_SIZE / _mapRatio, TILE_SIZE / _mapRatio);
 	QPointF tl(floor(rect.left() / ts.width()) * ts.width(),
 	  floor(rect.top() / ts.height()) * ts.height());
+	QList<QCTTile> tiles;
 
 	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
 	for (int i = 0; i < ceil(s.width() / ts.width()); i++) {
@@ -474,21 +527,46 @@ void QCTMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 			QPixmap pixmap;
 			QString key = path() + "/" + QString::number(x) + "_"
 			  + QString::number(y);
-			if (!QPixmapCache::find(key, &pixmap)) {
-				pixmap = tile(x, y);
-				if (!pixmap.isNull())
-					QPixmapCache::insert(key, pixmap);
-			}
 
-			if (pixmap.isNull())
-				qWarning("%s: error loading tile image", qPrintable(key));
-			else {
+			QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
+
+			if (QPixmapCache::find(key, &pixmap)) {
 				pixmap.setDevicePixelRatio(_mapRatio);
-				QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
 				painter->drawPixmap(tp, pixmap);
+			} else if (!(flags & Map::Block)
+			  && _scheduler.promote(key, rect.center()))
+				continue;
+			else {
+				QCTTile t(QPoint(i, j), tileData(x, y), _palette, key);
+				if (flags & Map::Block)
+					tiles.append(t);
+				else
+					_scheduler.render(t, key, QRectF(tp, ts).toRect(),
+					  rect.center());
 			}
 		}
 	}
+
+	/* The tiles data is read sequentially, the tiles are decoded
+	   in parallel, in the background unless the drawing must block
+	   (printing) */
+	QFuture<void> future = QtConcurrent::map(tiles, &QCTTile::render);
+	future.waitForFinished();
+
+	for (int i = 0; i < tiles.size(); i++) {
+		const QCTTile &mt = tiles.at(i);
+		QPixmap pm(QPixmap::fromImage(mt.image()));
+
+		if (pm.isNull())
+			qWarning("%s: error loading tile image", qPrintable(mt.key()));
+		else {
+			QPixmapCache::insert(mt.key(), pm);
+			pm.setDevicePixelRatio(_mapRatio);
+			QPointF tp(tl.x() + mt.xy().x() * ts.width(), tl.y() + mt.xy().y()
+			  * ts.height());
+			painter->drawPixmap(tp, pm);
+		}
+	}
 }
 
 Map *QCTMap::create(const QString &path, bool *isDir)
@@ -3,6 +3,7 @@
 
 #include <QFile>
 #include <QRgb>
+#include "tilescheduler.h"
 #include "map.h"
 
 class QDataStream;
@@ -20,6 +21,7 @@ public:
 	Coordinates xy2ll(const QPointF &p);
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void cancel(const QRectF &rect) {_scheduler.cancel(rect);}
 
 	void load(const Projection &in, const Projection &out, qreal deviceRatio,
 	  bool hidpi);
@@ -38,7 +40,7 @@ private:
 	bool readGeoRef(QDataStream &stream);
 	bool readIndex(QDataStream &stream);
 	bool readPalette(QDataStream &stream);
-	QPixmap tile(int x, int y);
+	QByteArray tileData(int x, int y);
 
 	QFile _file;
 	QString _name;
@@ -53,11 +55,14 @@ private:
 	  _norXXY, _norXXX;
 	double _shiftE, _shiftN;
 	QVector<quint32> _index;
+	QVector<quint32> _sizes;
 	QVector<QRgb> _palette;
 
 	qreal _mapRatio;
 	bool _valid;
 	QString _errorString;
+
+	TileScheduler _scheduler;
 };
 
 #endif // QCTMAP_H
@@ -4,6 +4,7 @@
 #include <QPainter>
 #include <QRegularExpression>
 #include <QtEndian>
+#include <QtConcurrent>
 #include "common/rectc.h"
 #include "common/wgs84.h"
 #include "common/color.h"
@@ -298,6 +299,8 @@ RMap::RMap(const QString &fileName, QObject *parent)
 		_errorString = "Error reading IMP data";
 		return;
 	}
+	connect(&_scheduler, &TileScheduler::finished, this, &RMap::tilesLoaded);
+
 	_valid = parseIMP(IMP);
 
 	_file.close();
@@ -367,72 +370,106 @@ void RMap::load(const Projection &in, const Projection &out, qreal deviceRatio,
 
 void RMap::unload()
 {
+	_scheduler.cancel(true);
 	_file.close();
 }
 
-QPixmap RMap::tile(int x, int y)
+class RMapTile
+{
+public:
+	RMapTile(const QPoint &xy, const QByteArray &data, const QSize &size,
+	  const QVector<QRgb> &palette, const QString &key) : _xy(xy), _data(data),
+	  _size(size), _palette(palette), _key(key) {}
+
+	const QPoint &xy() const {return _xy;}
+	const QString &key() const {return _key;}
+	const QImage &image() const {return _image;}
+	QPixmap pixmap() const {return QPixmap::fromImage(_image);}
+	bool isValid() const {return !_image.isNull();}
+
+	void render()
+	{
+		/* An invalid size marks JPEG tiles */
+		if (!_size.isValid()) {
+			_image = QImage::fromData(_data, "JPG");
+			return;
+		}
+
+		QByteArray uba = qUncompress(_data);
+		if (uba.size() < _size.width() * _size.height())
+			return;
+		QImage img((const uchar*)uba.constData(), _size.width(),
+		  _size.height(), QImage::Format_Indexed8);
+		img.setColorTable(_palette);
+		/* Detach from uba */
+		_image = img.copy();
+	}
+
+private:
+	QPoint _xy;
+	QByteArray _data;
+	QSize _size;
+	QVector<QRgb> _palette;
+	QString _key;
+	QImage _image;
+};
+
+QByteArray RMap::tileData(int x, int y, QSize &size)
 {
 	const Zoom &zoom = _zooms.at(_zoom);
 
 	qint32 index = y / _tileSize.height() * zoom.dim.width()
 	  + x / _tileSize.width();
 	if (index > zoom.tiles.size())
-		return QPixmap();
+		return QByteArray();
 
 	quint64 offset = zoom.tiles.at(index);
 	if (!_file.seek(offset))
-		return QPixmap();
+		return QByteArray();
 	QDataStream stream(&_file);
 	stream.setByteOrder(QDataStream::LittleEndian);
 	quint32 tag;
 	stream >> tag;
 	if (stream.status() != QDataStream::Ok)
-		return QPixmap();
+		return QByteArray();
 
 	if (tag == 2) {
 		if (_palette.isEmpty())
-			return QPixmap();
-		quint32 width, height, size;
-		stream >> width >> height >> size;
-		QSize tileSize(width, -(int)height);
+			return QByteArray();
+		quint32 width, height, len;
+		stream >> width >> height >> len;
+		size = QSize(width, -(int)height);
 
-		quint32 bes = qToBigEndian(tileSize.width() * tileSize.height());
+		quint32 bes = qToBigEndian(size.width() * size.height());
 		QByteArray ba;
-		ba.resize(sizeof(bes) + size);
+		ba.resize(sizeof(bes) + len);
 		memcpy(ba.data(), &bes, sizeof(bes));
 
-		if (stream.readRawData(ba.data() + sizeof(bes), size) != (int)size)
-			return QPixmap();
-		QByteArray uba = qUncompress(ba);
-		if (uba.size() < tileSize.width() * tileSize.height())
-			return QPixmap();
-		QImage img((const uchar*)uba.constData(), tileSize.width(),
-		  tileSize.height(), QImage::Format_Indexed8);
-		img.setColorTable(_palette);
+		if (stream.readRawData(ba.data() + sizeof(bes), len) != (int)len)
+			return QByteArray();
 
-		return QPixmap::fromImage(img);
+		return ba;
 	} else if (tag == 7) {
 		quint32 len;
 		stream >> len;
+		size = QSize();
 
 		QByteArray ba;
 		ba.resize(len);
 		if (stream.readRawData(ba.data(), ba.size()) != ba.size())
-			return QPixmap();
+			return QByteArray();
 
-		QImage img(QImage::fromData(ba, "JPG"));
-		return QPixmap::fromImage(img);
+		return ba;
 	} else
-		return QPixmap();
+		return QByteArray();
 }
 
 void RMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 {
-	Q_UNUSED(flags);
-
 	QSizeF ts(_tileSize.width() / _mapRatio, _tileSize.height() / _mapRatio);
 	QPointF tl(floor(rect.left() / ts.width()) * ts.width(),
 	  floor(rect.top() / ts.height()) * ts.height());
+	QList<RMapTile> tiles;
 
 	QSizeF s(rect.right() - tl.x(), rect.bottom() - tl.y());
 	for (int i = 0; i < ceil(s.width() / ts.width()); i++) {
@@ -443,21 +480,48 @@ void RMap::draw(QPainter *painter, const QRectF &rect, Flags flags)
 			QPixmap pixmap;
 			QString key = path() + "/" + QString::number(_zoom) + "_"
 			  + QString::number(x) + "_" + QString::number(y);
-			if (!QPixmapCache::find(key, &pixmap)) {
-				pixmap = tile(x, y);
-				if (!pixmap.isNull())
-					QPixmapCache::insert(key, pixmap);
-			}
 
-			if (pixmap.isNull())
-				qWarning("%s: error loading tile image", qPrintable(key));
-			else {
+			QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
+
+			if (QPixmapCache::find(key, &pixmap)) {
 				pixmap.setDevicePixelRatio(_mapRatio);
-				QPointF tp(tl.x() + i * ts.width(), tl.y() + j * ts.height());
 				painter->drawPixmap(tp, pixmap);
+			} else if (!(flags & Map::Block)
+			  && _scheduler.promote(key, rect.center()))
+				continue;
+			else {
+				QSize size;
+				QByteArray data(tileData(x, y, size));
+				RMapTile t(QPoint(i, j), data, size, _palette, key);
+				if (flags & Map::Block)
+					tiles.append(t);
+				else
+					_scheduler.render(t, key, QRectF(tp, ts).toRect(),
+					  rect.center());
 			}
 		}
 	}
+
+	/* The tiles data is read sequentially, the decompression/JPEG decoding
+	   runs in parallel, in the background unless the drawing must block
+	   (printing) */
+	QFuture<void> future = QtConcurrent::map(tiles, &RMapTile::render);
+	future.waitForFinished();
+
+	for (int i = 0; i < tiles.size(); i++) {
+		const RMapTile &mt = tiles.at(i);
+		QPixmap pm(QPixmap::fromImage(mt.image()));
+
+		if (pm.isNull())
+			qWarning("%s: error loading tile image", qPrintable(mt.key()));
+		else {
+			QPixmapCache::insert(mt.key(), pm);
+			pm.setDevicePixelRatio(_mapRatio);
+			QPointF tp(tl.x() + mt.xy().x() * ts.width(), tl.y() + mt.xy().y()
+			  * ts.height());
+			painter->drawPixmap(tp, pm);
+		}
+	}
 }
 
 Map *RMap::create(const QString &path, bool *isDir)
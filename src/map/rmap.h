@@ -3,6 +3,7 @@
 
 #include <QFile>
 #include <QColor>
+#include "tilescheduler.h"
 #include "map.h"
 #include "transform.h"
 #include "projection.h"
@@ -30,6 +31,7 @@ public:
 	void unload();
 
 	void draw(QPainter *painter, const QRectF &rect, Flags flags);
+	void cancel(const QRectF &rect) {_scheduler.cancel(rect);}
 
 	bool isValid() const {return _valid;}
 	QString errorString() const {return _errorString;}
@@ -62,7 +64,7 @@ private:
 	bool readZoomLevel(quint64 offset, const QSize &imageSize);
 	QByteArray readIMP(quint64 IMPOffset);
 	bool parseIMP(const QByteArray &data);
-	QPixmap tile(int x, int y);
+	QByteArray tileData(int x, int y, QSize &size);
 
 	QList<Zoom> _zooms;
 	Projection _projection;
@@ -75,6 +77,8 @@ private:
 
 	bool _valid;
 	QString _errorString;
+
+	TileScheduler _scheduler;
 };
 
 #endif // RMAP_H
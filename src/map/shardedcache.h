@@ -0,0 +1,131 @@
+#ifndef SHARDEDCACHE_H
+#define SHARDEDCACHE_H
+
+#include <QCache>
+#include <QMutex>
+#include <QAtomicInt>
+#include "common/hash.h"
+
+#define CACHE_SHARDS 16
+
+/* QCache split into independently locked shards, so that threads working
+   with different keys do not contend for a single lock. The shard's lock must
+   be held while its cache is used and the cached objects may only be used
+   while the lock is held.
+
+   The max cost applies to the whole cache, not to the individual shards.
+   Every shard accepts objects up to the max cost and trim() (which must be
+   called with no shard locked) shrinks all the shards when the cache as a
+   whole exceeds the limit. Every shard loses a share of the excess cost
+   proportional to its size, evicting its own least recently used objects.
+   The recency is only tracked within a shard, not across the shards. */
+template <class Key, class T>
+class ShardedCache
+{
+public:
+	struct Shard {
+		QMutex lock;
+		QCache<Key, T> cache;
+		QAtomicInt cost;
+	};
+
+	ShardedCache() : _maxCost(100) {}
+
+	Shard &shard(const Key &key)
+	{
+		/* The keys are often pointers with the low bits all zero due to
+		   the memory alignment, mix the hash before taking the modulo */
+		quint32 h = (quint32)qHash(key);
+		h ^= h >> 16;
+		h *= 0x45d9f3b;
+		h ^= h >> 16;
+
+		return _shards[h % CACHE_SHARDS];
+	}
+
+	/* The shard's lock must be held */
+	void insert(Shard &shard, const Key &key, T *object, int cost)
+	{
+		shard.cache.insert(key, object, cost);
+		shard.cost.storeRelease(shard.cache.totalCost());
+	}
+
+	qint64 totalCost() const
+	{
+		qint64 cost = 0;
+		for (int i = 0; i < CACHE_SHARDS; i++)
+			cost += _shards[i].cost.loadAcquire();
+		return cost;
+	}
+
+	/* Trims the cache to the max cost after an insert. Concurrent trims would
+	   evict more than required, so the trim is skipped when another one is
+	   already running. */
+	void trim()
+	{
+		if (!_trimLock.tryLock())
+			return;
+		evict(_maxCost.loadAcquire());
+		_trimLock.unlock();
+	}
+
+	/* Trims the cache to the given cost, waits for any running trim to
+	   finish first so that the cache is always shrunk to the cost */
+	void trim(qint64 maxCost)
+	{
+		_trimLock.lock();
+		evict(maxCost);
+		_trimLock.unlock();
+	}
+
+	void setMaxCost(int cost)
+	{
+		_maxCost.storeRelease(cost);
+
+		for (int i = 0; i < CACHE_SHARDS; i++) {
+			_shards[i].lock.lock();
+			_shards[i].cache.setMaxCost(cost);
+			_shards[i].cost.storeRelease(_shards[i].cache.totalCost());
+			_shards[i].lock.unlock();
+		}
+
+		trim(cost);
+	}
+
+	void clear()
+	{
+		for (int i = 0; i < CACHE_SHARDS; i++) {
+			_shards[i].lock.lock();
+			_shards[i].cache.clear();
+			_shards[i].cost.storeRelease(0);
+			_shards[i].lock.unlock();
+		}
+	}
+
+private:
+	/* Must be called with the trim lock held */
+	void evict(qint64 maxCost)
+	{
+		qint64 total = totalCost();
+		if (total <= maxCost)
+			return;
+
+		qint64 excess = total - maxCost;
+		for (int i = 0; i < CACHE_SHARDS; i++) {
+			Shard &s = _shards[i];
+			s.lock.lock();
+			qint64 cost = s.cache.totalCost();
+			qint64 target = cost - (excess * cost + total - 1) / total;
+			s.cache.setMaxCost((int)qMax(target, (qint64)0));
+			s.cache.setMaxCost(_maxCost.loadAcquire());
+			s.cost.storeRelease(s.cache.totalCost());
+			s.lock.unlock();
+		}
+	}
+
+	Shard _shards[CACHE_SHARDS];
+	QAtomicInt _maxCost;
+	QMutex _trimLock;
+};
+
+#endif // SHARDEDCACHE_H
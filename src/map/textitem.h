@@ -6,6 +6,7 @@
 #include <QPainterPath>
 
 class QPainter;
+class TextItemGrid;
 
 class TextItem
 {
@@ -19,6 +20,7 @@ public:
 
 	const QString *text() const {return _text;}
 	bool collides(const QList<TextItem*> &list) const;
+	bool collides(const TextItemGrid &grid) const;
 
 protected:
 	const QString *_text;
@@ -0,0 +1,77 @@
+#include <QtMath>
+#include "textitem.h"
+#include "textitemgrid.h"
+
+#define CELL_SIZE 64
+
+static inline quint64 cell(int x, int y)
+{
+	return ((quint64)(quint32)x << 32) | (quint32)y;
+}
+
+static QRect cells(const QRectF &rect)
+{
+	return QRect(QPoint(qFloor(rect.left() / CELL_SIZE),
+	  qFloor(rect.top() / CELL_SIZE)), QPoint(qFloor(rect.right() / CELL_SIZE),
+	  qFloor(rect.bottom() / CELL_SIZE)));
+}
+
+void TextItemGrid::append(TextItem *item)
+{
+	QRectF rect(item->boundingRect());
+	int idx = _items.size();
+
+	_items.append(item);
+	_stamps.append(0);
+
+	/* Items with empty bounding rects never collide */
+	if (rect.isEmpty())
+		return;
+
+	QRect c(cells(rect));
+	for (int y = c.top(); y <= c.bottom(); y++)
+		for (int x = c.left(); x <= c.right(); x++)
+			_cells[cell(x, y)].append(idx);
+}
+
+bool TextItemGrid::collides(const TextItem *item) const
+{
+	QRectF r1(item->boundingRect());
+	if (r1.isEmpty())
+		return false;
+
+	QPainterPath shape;
+	bool hasShape = false;
+
+	_query++;
+
+	QRect c(cells(r1));
+	for (int y = c.top(); y <= c.bottom(); y++) {
+		for (int x = c.left(); x <= c.right(); x++) {
+			QHash<quint64, QVector<int> >::const_iterator it
+			  = _cells.find(cell(x, y));
+			if (it == _cells.constEnd())
+				continue;
+
+			const QVector<int> &list = it.value();
+			for (int i = 0; i < list.size(); i++) {
+				int idx = list.at(i);
+				if (_stamps.at(idx) == _query)
+					continue;
+				_stamps[idx] = _query;
+
+				const TextItem *other = _items.at(idx);
+				if (!r1.intersects(other->boundingRect()))
+					continue;
+				if (!hasShape) {
+					shape = item->shape();
+					hasShape = true;
+				}
+				if (other->shape().intersects(shape))
+					return true;
+			}
+		}
+	}
+
+	return false;
+}
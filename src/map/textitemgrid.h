@@ -0,0 +1,34 @@
+#ifndef TEXTITEMGRID_H
+#define TEXTITEMGRID_H
+
+#include <QList>
+#include <QVector>
+#include <QHash>
+
+class TextItem;
+
+/* Text items collision index. The items are registered into a sparse
+   uniform grid by their bounding rects, so a collision check only tests
+   the items sharing a grid cell with the checked item (and their shapes only
+   on bounding rect hits) instead of all the items of the tile. The grid does
+   not own the items. */
+class TextItemGrid
+{
+public:
+	TextItemGrid() : _query(0) {}
+
+	void append(TextItem *item);
+	bool collides(const TextItem *item) const;
+
+	const QList<TextItem*> &items() const {return _items;}
+	int size() const {return _items.size();}
+
+private:
+	QList<TextItem*> _items;
+	QHash<quint64, QVector<int> > _cells;
+	/* Per-query marks to test items spanning multiple cells only once */
+	mutable QVector<int> _stamps;
+	mutable int _query;
+};
+
+#endif // TEXTITEMGRID_H
@@ -0,0 +1,564 @@
+#include <cstring>
+#include <cmath>
+#include <QPainter>
+#include <QPixmapCache>
+#include <QtEndian>
+#include "common/tifffile.h"
+#include "tiffimage.h"
+
+#define NewSubfileTypeTag             254
+#define ImageWidthTag                 256
+#define ImageLengthTag                257
+#define BitsPerSampleTag              258
+#define CompressionTag                259
+#define PhotometricInterpretationTag  262
+#define StripOffsetsTag               273
+#define SamplesPerPixelTag            277
+#define RowsPerStripTag               278
+#define StripByteCountsTag            279
+#define PlanarConfigurationTag        284
+#define PredictorTag                  317
+#define ColorMapTag                   320
+#define TileWidthTag                  322
+#define TileLengthTag                 323
+#define TileOffsetsTag                324
+#define TileByteCountsTag             325
+#define ExtraSamplesTag               338
+#define SampleFormatTag               339
+
+#define COMPRESSION_NONE              1
+#define COMPRESSION_LZW               5
+#define COMPRESSION_DEFLATE           8
+#define COMPRESSION_ADOBE_DEFLATE     32946
+#define COMPRESSION_PACKBITS          32773
+
+#define PHOTOMETRIC_MINISBLACK        1
+#define PHOTOMETRIC_RGB               2
+#define PHOTOMETRIC_PALETTE           3
+
+#define FILETYPE_REDUCEDIMAGE         1
+#define FILETYPE_MASK                 4
+
+#define EXTRASAMPLE_ASSOCALPHA        1
+
+#define MAX_IFDS 64
+
+#define LZW_CLEAR 256
+#define LZW_EOI   257
+#define LZW_FIRST 258
+#define LZW_MAX   4096
+
+static bool lzw(const QByteArray &in, QByteArray &out)
+{
+	quint16 prefix[LZW_MAX], length[LZW_MAX];
+	quint8 suffix[LZW_MAX], first[LZW_MAX];
+	const quint8 *src = (const quint8*)in.constData();
+	quint8 *dst = (quint8*)out.data();
+	int srcPos = 0, dstPos = 0, bits = 0, codeLen = 9, next = LZW_FIRST;
+	int prev = -1;
+	quint32 buffer = 0;
+
+	for (int i = 0; i < 256; i++) {
+		prefix[i] = 0;
+		length[i] = 1;
+		suffix[i] = i;
+		first[i] = i;
+	}
+
+	while (dstPos < out.size()) {
+		while (bits < codeLen) {
+			/* Truncated data, keep what has been decoded */
+			if (srcPos >= in.size())
+				return true;
+			buffer = (buffer << 8) | src[srcPos++];
+			bits += 8;
+		}
+		int code = (buffer >> (bits - codeLen)) & ((1 << codeLen) - 1);
+		bits -= codeLen;
+
+		if (code == LZW_EOI)
+			break;
+		if (code == LZW_CLEAR) {
+			codeLen = 9;
+			next = LZW_FIRST;
+			prev = -1;
+			continue;
+		}
+
+		if (prev < 0) {
+			if (code > 255)
+				return false;
+			dst[dstPos++] = code;
+			prev = code;
+			continue;
+		}
+
+		if (code > next || (code == next && next >= LZW_MAX))
+			return false;
+		if (next < LZW_MAX) {
+			prefix[next] = prev;
+			suffix[next] = (code == next) ? first[prev] : first[code];
+			first[next] = first[prev];
+			length[next] = length[prev] + 1;
+			next++;
+		}
+
+		/* The string is written backwards from its end */
+		int len = length[code];
+		if (dstPos + len > out.size())
+			len = out.size() - dstPos;
+		int c = code;
+		for (int i = length[code] - 1; i >= 0; i--) {
+			if (i < len)
+				dst[dstPos + i] = suffix[c];
+			c = prefix[c];
+		}
+		dstPos += len;
+		prev = code;
+
+		/* TIFF LZW "early change" */
+		if (next + 1 >= (1 << codeLen) && codeLen < 12)
+			codeLen++;
+	}
+
+	return true;
+}
+
+static bool packBits(const QByteArray &in, QByteArray &out)
+{
+	const char *src = in.constData();
+	char *dst = out.data();
+	int srcPos = 0, dstPos = 0;
+
+	while (srcPos < in.size() && dstPos < out.size()) {
+		int n = (qint8)src[srcPos++];
+
+		if (n >= 0) {
+			n = qMin(qMin(n + 1, in.size() - srcPos), out.size() - dstPos);
+			memcpy(dst + dstPos, src + srcPos, n);
+			srcPos += n;
+			dstPos += n;
+		} else if (n != -128) {
+			if (srcPos >= in.size())
+				return false;
+			n = qMin(1 - n, out.size() - dstPos);
+			memset(dst + dstPos, src[srcPos++], n);
+			dstPos += n;
+		}
+	}
+
+	return true;
+}
+
+static bool deflate(const QByteArray &in, QByteArray &out)
+{
+	/* qUncompress() expects the (big endian) uncompressed data size in front
+	   of the zlib stream */
+	QByteArray data(4, 0);
+	qToBigEndian((quint32)out.size(), (uchar*)data.data());
+	data.append(in);
+
+	QByteArray ba(qUncompress(data));
+	if (ba.isEmpty())
+		return false;
+	memcpy(out.data(), ba.constData(), qMin(ba.size(), out.size()));
+
+	return true;
+}
+
+static int typeSize(quint16 type)
+{
+	switch (type) {
+		case TIFF_BYTE:
+			return 1;
+		case TIFF_SHORT:
+			return 2;
+		case TIFF_LONG:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+TIFFImage::TIFFImage(const QString &fileName)
+  : _file(fileName), _ratio(1.0)
+{
+	if (!_file.open(QIODevice::ReadOnly))
+		return;
+
+	TIFFFile file(&_file);
+	if (!file.isValid())
+		return;
+
+	quint32 offset = file.ifd();
+	for (int i = 0; offset && i < MAX_IFDS; i++) {
+		Level level;
+
+		if (!readIFD(file, offset, level, offset))
+			break;
+
+		if (_levels.isEmpty()) {
+			/* The full resolution image must be supported, otherwise
+			   the whole image is unsupported */
+			if (!isSupported(level))
+				return;
+			_levels.append(level);
+		} else if ((level.subfileType & FILETYPE_REDUCEDIMAGE)
+		  && !(level.subfileType & FILETYPE_MASK) && isSupported(level)
+		  && level.size.width() < _levels.last().size.width())
+			_levels.append(level);
+	}
+}
+
+bool TIFFImage::readValues(TIFFFile &file, qint64 pos, quint16 type,
+  quint32 count, QVector<quint32> &values)
+{
+	int size = typeSize(type);
+	if (!size)
+		return false;
+
+	/* Values that fit into the entry value field are stored directly
+	   in the field, otherwise the field contains the values offset */
+	if (!file.seek(pos))
+		return false;
+	if ((quint64)count * size > 4) {
+		quint32 offset;
+		if (!(file.readValue(offset) && file.seek(offset)))
+			return false;
+	}
+
+	values.resize(count);
+	for (quint32 i = 0; i < count; i++) {
+		if (type == TIFF_BYTE) {
+			quint8 val;
+			if (!file.readValue(val))
+				return false;
+			values[i] = val;
+		} else if (type == TIFF_SHORT) {
+			quint16 val;
+			if (!file.readValue(val))
+				return false;
+			values[i] = val;
+		} else {
+			if (!file.readValue(values[i]))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool TIFFImage::readEntry(TIFFFile &file, qint64 pos, Level &level)
+{
+	quint16 tag, type;
+	quint32 count;
+	QVector<quint32> values;
+
+	if (!(file.seek(pos) && file.readValue(tag) && file.readValue(type)
+	  && file.readValue(count)))
+		return false;
+
+	switch (tag) {
+		case NewSubfileTypeTag:
+		case ImageWidthTag:
+		case ImageLengthTag:
+		case BitsPerSampleTag:
+		case CompressionTag:
+		case PhotometricInterpretationTag:
+		case StripOffsetsTag:
+		case SamplesPerPixelTag:
+		case RowsPerStripTag:
+		case StripByteCountsTag:
+		case PlanarConfigurationTag:
+		case PredictorTag:
+		case ColorMapTag:
+		case TileWidthTag:
+		case TileLengthTag:
+		case TileOffsetsTag:
+		case TileByteCountsTag:
+		case ExtraSamplesTag:
+		case SampleFormatTag:
+			if (!count || !readValues(file, pos + 8, type, count, values))
+				return false;
+			break;
+		default:
+			return true;
+	}
+
+	switch (tag) {
+		case NewSubfileTypeTag:
+			level.subfileType = values.first();
+			break;
+		case ImageWidthTag:
+			level.size.setWidth(values.first());
+			break;
+		case ImageLengthTag:
+			level.size.setHeight(values.first());
+			break;
+		case BitsPerSampleTag:
+			level.bits = values.first();
+			for (int i = 1; i < values.size(); i++)
+				if (values.at(i) != level.bits)
+					level.bits = 0;
+			break;
+		case CompressionTag:
+			level.compression = values.first();
+			break;
+		case PhotometricInterpretationTag:
+			level.photometric = values.first();
+			break;
+		case StripOffsetsTag:
+		case TileOffsetsTag:
+			level.offsets = values;
+			break;
+		case SamplesPerPixelTag:
+			level.samples = values.first();
+			break;
+		case RowsPerStripTag:
+			level.rowsPerStrip = values.first();
+			break;
+		case StripByteCountsTag:
+		case TileByteCountsTag:
+			level.sizes = values;
+			break;
+		case PlanarConfigurationTag:
+			level.planar = values.first();
+			break;
+		case PredictorTag:
+			level.predictor = values.first();
+			break;
+		case ColorMapTag:
+			if (values.size() % 3)
+				return false;
+			level.colorTable.resize(values.size() / 3);
+			for (int i = 0; i < level.colorTable.size(); i++)
+				level.colorTable[i] = qRgb(values.at(i) >> 8,
+				  values.at(level.colorTable.size() + i) >> 8,
+				  values.at(2 * level.colorTable.size() + i) >> 8);
+			break;
+		case TileWidthTag:
+			level.blockSize.setWidth(values.first());
+			level.tiled = true;
+			break;
+		case TileLengthTag:
+			level.blockSize.setHeight(values.first());
+			level.tiled = true;
+			break;
+		case ExtraSamplesTag:
+			level.alpha = values.first();
+			break;
+		case SampleFormatTag:
+			level.format = values.first();
+			break;
+	}
+
+	return true;
+}
+
+bool TIFFImage::readIFD(TIFFFile &file, quint32 offset, Level &level,
+  quint32 &next)
+{
+	quint16 count;
+
+	if (!(file.seek(offset) && file.readValue(count)))
+		return false;
+
+	for (quint16 i = 0; i < count; i++)
+		if (!readEntry(file, offset + 2 + i * 12, level))
+			return false;
+
+	if (!(file.seek(offset + 2 + count * 12) && file.readValue(next)))
+		return false;
+
+	if (!level.tiled)
+		level.blockSize = QSize(level.size.width(), level.rowsPerStrip
+		  ? (int)qMin(level.rowsPerStrip, (quint32)level.size.height())
+		  : level.size.height());
+
+	return true;
+}
+
+bool TIFFImage::isSupported(const Level &level) const
+{
+	if (level.size.isEmpty() || level.blockSize.isEmpty())
+		return false;
+	if (level.bits != 8 || level.format != 1)
+		return false;
+	if (level.planar != 1 && level.samples > 1)
+		return false;
+	if (level.predictor != 1 && level.predictor != 2)
+		return false;
+
+	switch (level.compression) {
+		case COMPRESSION_NONE:
+		case COMPRESSION_LZW:
+		case COMPRESSION_DEFLATE:
+		case COMPRESSION_ADOBE_DEFLATE:
+		case COMPRESSION_PACKBITS:
+			break;
+		default:
+			return false;
+	}
+
+	switch (level.photometric) {
+		case PHOTOMETRIC_MINISBLACK:
+			if (level.samples != 1 && level.samples != 2)
+				return false;
+			break;
+		case PHOTOMETRIC_RGB:
+			if (level.samples != 3 && level.samples != 4)
+				return false;
+			break;
+		case PHOTOMETRIC_PALETTE:
+			if (level.samples != 1 || level.colorTable.size() != 256)
+				return false;
+			break;
+		default:
+			return false;
+	}
+
+	int cols = (level.size.width() + level.blockSize.width() - 1)
+	  / level.blockSize.width();
+	int rows = (level.size.height() + level.blockSize.height() - 1)
+	  / level.blockSize.height();
+
+	return (level.offsets.size() == cols * rows
+	  && level.sizes.size() == level.offsets.size());
+}
+
+QImage TIFFImage::block(const Level &level, int x, int y)
+{
+	int cols = (level.size.width() + level.blockSize.width() - 1)
+	  / level.blockSize.width();
+	int idx = y * cols + x;
+	int width = level.blockSize.width();
+	int height = level.tiled ? level.blockSize.height()
+	  : qMin(level.blockSize.height(), level.size.height()
+	  - y * level.blockSize.height());
+	int bpl = width * level.samples;
+
+	if (!_file.seek(level.offsets.at(idx)))
+		return QImage();
+	QByteArray in(_file.read(level.sizes.at(idx)));
+	if (in.size() != (int)level.sizes.at(idx))
+		return QImage();
+
+	QByteArray data;
+	if (level.compression == COMPRESSION_NONE)
+		data = in;
+	else {
+		data = QByteArray(bpl * height, 0);
+		bool ret;
+		switch (level.compression) {
+			case COMPRESSION_LZW:
+				ret = lzw(in, data);
+				break;
+			case COMPRESSION_PACKBITS:
+				ret = packBits(in, data);
+				break;
+			default:
+				ret = deflate(in, data);
+		}
+		if (!ret)
+			return QImage();
+	}
+	if (data.size() < bpl * height)
+		return QImage();
+
+	if (level.predictor == 2) {
+		quint8 *d = (quint8*)data.data();
+		for (int i = 0; i < height; i++) {
+			quint8 *row = d + i * bpl;
+			for (int j = level.samples; j < bpl; j++)
+				row[j] += row[j - level.samples];
+		}
+	}
+
+	const uchar *src = (const uchar*)data.constData();
+	QImage img;
+
+	if (level.photometric == PHOTOMETRIC_PALETTE) {
+		img = QImage(width, height, QImage::Format_Indexed8);
+		img.setColorTable(level.colorTable);
+	} else if (level.photometric == PHOTOMETRIC_MINISBLACK)
+		img = QImage(width, height, (level.samples == 1)
+		  ? QImage::Format_Grayscale8 : QImage::Format_ARGB32);
+	else if (level.samples == 3)
+		img = QImage(width, height, QImage::Format_RGB888);
+	else
+		img = QImage(width, height, (level.alpha == EXTRASAMPLE_ASSOCALPHA)
+		  ? QImage::Format_RGBA8888_Premultiplied : QImage::Format_RGBA8888);
+	if (img.isNull())
+		return img;
+
+	for (int i = 0; i < height; i++) {
+		const uchar *row = src + i * bpl;
+
+		if (level.photometric == PHOTOMETRIC_MINISBLACK && level.samples == 2) {
+			QRgb *dst = (QRgb*)img.scanLine(i);
+			for (int j = 0; j < width; j++)
+				dst[j] = qRgba(row[2*j], row[2*j], row[2*j], row[2*j+1]);
+		} else
+			memcpy(img.scanLine(i), row, bpl);
+	}
+
+	return img;
+}
+
+int TIFFImage::level(QPainter *painter) const
+{
+	/* Required resolution of the image relative to the full resolution */
+	qreal scale = painter->deviceTransform().map(QLineF(0, 0, 1, 0)).length()
+	  * painter->device()->devicePixelRatioF() / _ratio;
+	int width = _levels.first().size.width();
+
+	for (int i = _levels.size() - 1; i > 0; i--)
+		if (_levels.at(i).size.width() >= width * scale)
+			return i;
+
+	return 0;
+}
+
+void TIFFImage::draw(QPainter *painter, const QRectF &rect, Map::Flags flags)
+{
+	Q_UNUSED(flags);
+
+	int l = level(painter);
+	const Level &level = _levels.at(l);
+	const QSize &bs = level.blockSize;
+	qreal sx = (qreal)_levels.first().size.width() / level.size.width();
+	qreal sy = (qreal)_levels.first().size.height() / level.size.height();
+	qreal kx = _ratio / sx, ky = _ratio / sy;
+
+	int cols = (level.size.width() + bs.width() - 1) / bs.width();
+	int rows = (level.size.height() + bs.height() - 1) / bs.height();
+	int left = qMax(0, (int)floor(rect.left() * kx / bs.width()));
+	int top = qMax(0, (int)floor(rect.top() * ky / bs.height()));
+	int right = qMin(cols - 1, (int)floor(rect.right() * kx / bs.width()));
+	int bottom = qMin(rows - 1, (int)floor(rect.bottom() * ky / bs.height()));
+
+	for (int y = top; y <= bottom; y++) {
+		for (int x = left; x <= right; x++) {
+			QPixmap pixmap;
+			QString key = _file.fileName() + "/" + QString::number(l) + "_"
+			  + QString::number(x) + "_" + QString::number(y);
+			if (!QPixmapCache::find(key, &pixmap)) {
+				pixmap = QPixmap::fromImage(block(level, x, y));
+				if (!pixmap.isNull())
+					QPixmapCache::insert(key, pixmap);
+			}
+
+			if (pixmap.isNull())
+				qWarning("%s: error loading tile image", qPrintable(key));
+			else {
+				/* Edge tiles may be padded beyond the image bounds */
+				QRectF src(0, 0, qMin(bs.width(), level.size.width()
+				  - x * bs.width()), qMin(bs.height(), level.size.height()
+				  - y * bs.height()));
+				QRectF dst(x * bs.width() / kx, y * bs.height() / ky,
+				  src.width() / kx, src.height() / ky);
+				painter->drawPixmap(dst, pixmap, src);
+			}
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef TIFFIMAGE_H
+#define TIFFIMAGE_H
+
+#include <QFile>
+#include <QVector>
+#include <QImage>
+#include "map.h"
+
+class QPainter;
+class TIFFFile;
+
+/* Windowed TIFF image. Only the TIFF tiles/strips intersecting the drawn
+   rect are decoded (and cached in the pixmap cache) and the reduced
+   resolution images (overviews) are used when the image is drawn scaled
+   down. Only 8bit grayscale, palette and RGB(A) images with no, LZW,
+   Deflate or PackBits compression are supported, isValid() returns false
+   for all other images. */
+class TIFFImage
+{
+public:
+	TIFFImage(const QString &fileName);
+
+	bool isValid() const {return !_levels.isEmpty();}
+	QSize size() const
+	  {return isValid() ? _levels.first().size : QSize();}
+
+	void draw(QPainter *painter, const QRectF &rect, Map::Flags flags);
+	void setDevicePixelRatio(qreal ratio) {_ratio = ratio;}
+
+private:
+	struct Level
+	{
+		Level() : subfileType(0), bits(8), samples(1), compression(1),
+		  photometric(0xFFFF), planar(1), predictor(1), format(1), alpha(0),
+		  rowsPerStrip(0), tiled(false) {}
+
+		QSize size;
+		QSize blockSize;
+		quint32 subfileType;
+		quint32 bits;
+		quint32 samples;
+		quint32 compression;
+		quint32 photometric;
+		quint32 planar;
+		quint32 predictor;
+		quint32 format;
+		quint32 alpha;
+		quint32 rowsPerStrip;
+		bool tiled;
+		QVector<quint32> offsets;
+		QVector<quint32> sizes;
+		QVector<QRgb> colorTable;
+	};
+
+	bool readIFD(TIFFFile &file, quint32 offset, Level &level, quint32 &next);
+	bool readEntry(TIFFFile &file, qint64 pos, Level &level);
+	bool readValues(TIFFFile &file, qint64 pos, quint16 type, quint32 count,
+	  QVector<quint32> &values);
+	bool isSupported(const Level &level) const;
+	int level(QPainter *painter) const;
+	QImage block(const Level &level, int x, int y);
+
+	QFile _file;
+	QVector<Level> _levels;
+	qreal _ratio;
+};
+
+#endif // TIFFIMAGE_H
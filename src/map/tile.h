@@ -35,8 +35,11 @@ public:
 	const QPoint &xy() const {return _xy;}
 	const QString &key() const {return _key;}
 	const QPixmap &pixmap() const {return _pixmap;}
+	bool isValid() const {return !_pixmap.isNull();}
 
 	void load() {_pixmap.loadFromData(_data);}
+	/* TileScheduler interface */
+	void render() {load();}
 
 private:
 	QPoint _xy;
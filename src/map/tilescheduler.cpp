@@ -0,0 +1,165 @@
+#include <QThreadPool>
+#include <QPixmapCache>
+#include "tilescheduler.h"
+
+
+#define PREFETCH_PRIORITY -0x7FFFFFFF
+
+static int priority(const QRect &rect, const QPointF &center)
+{
+	/* QThreadPool runs the tasks with higher priority first */
+	QPointF dist(QRectF(rect).center() - center);
+	return -qRound(dist.manhattanLength());
+}
+
+void TileScheduler::Task::run()
+{
+	render();
+	_scheduler->done(this);
+}
+
+TileScheduler::~TileScheduler()
+{
+	cancel(true);
+	qDeleteAll(_tasks);
+}
+
+bool TileScheduler::isRunning(const QString &key) const
+{
+	QHash<QString, Task*>::const_iterator it = _tasks.find(key);
+	return (it != _tasks.constEnd() && !it.value()->_prefetch);
+}
+
+void TileScheduler::schedule(Task *task, const QString &key, const QRect &rect,
+  const QPointF &center, bool prefetch)
+{
+	task->_scheduler = this;
+	task->_key = key;
+	task->_rect = rect;
+	task->_prefetch = prefetch;
+
+	_tasks.insert(key, task);
+
+	_lock.lock();
+	_running++;
+	_lock.unlock();
+
+	QThreadPool::globalInstance()->start(task, prefetch
+	  ? PREFETCH_PRIORITY : priority(rect, center));
+}
+
+bool TileScheduler::promote(const QString &key, const QPointF &center)
+{
+	Task *task = _tasks.value(key);
+	if (!task)
+		return false;
+	if (!task->_prefetch)
+		return true;
+
+	/* A tile that has been prefetched is now needed for the view. If it is
+	   still queued, re-queue it with the regular priority, otherwise just
+	   make it signal its completion. */
+	task->_prefetch = false;
+	if (QThreadPool::globalInstance()->tryTake(task))
+		QThreadPool::globalInstance()->start(task, priority(task->_rect,
+		  center));
+
+	return true;
+}
+
+void TileScheduler::take(QHash<QString, Task*>::iterator &it)
+{
+	_lock.lock();
+	_running--;
+	_lock.unlock();
+
+	delete it.value();
+	it = _tasks.erase(it);
+}
+
+void TileScheduler::done(Task *task)
+{
+	/* Called from the worker thread, the result is processed in the thread
+	   of the scheduler */
+	QMetaObject::invokeMethod(this, "taskFinished", Qt::QueuedConnection,
+	  Q_ARG(QString, task->_key));
+
+	_lock.lock();
+	_running--;
+	_cond.wakeAll();
+	_lock.unlock();
+}
+
+void TileScheduler::taskFinished(const QString &key)
+{
+	Task *task = _tasks.take(key);
+	if (!task)
+		return;
+
+	bool prefetch = task->_prefetch;
+	bool valid = task->isValid();
+
+	if (valid)
+		QPixmapCache::insert(key, task->pixmap());
+	else
+		qWarning("%s: error rendering tile", qPrintable(key));
+	delete task;
+
+	/* Failed tiles do not trigger a repaint, it would schedule them again
+	   and again */
+	if (!prefetch && valid)
+		emit finished();
+}
+
+void TileScheduler::cancel(const QRectF &rect)
+{
+	QThreadPool *pool = QThreadPool::globalInstance();
+	QHash<QString, Task*>::iterator it = _tasks.begin();
+
+	while (it != _tasks.end()) {
+		Task *task = it.value();
+
+		if (!task->_prefetch && !rect.intersects(task->_rect)
+		  && pool->tryTake(task))
+			take(it);
+		else
+			++it;
+	}
+}
+
+void TileScheduler::cancelPrefetch()
+{
+	QThreadPool *pool = QThreadPool::globalInstance();
+	QHash<QString, Task*>::iterator it = _tasks.begin();
+
+	while (it != _tasks.end()) {
+		Task *task = it.value();
+
+		if (task->_prefetch && pool->tryTake(task))
+			take(it);
+		else
+			++it;
+	}
+}
+
+void TileScheduler::cancel(bool wait)
+{
+	QThreadPool *pool = QThreadPool::globalInstance();
+	QHash<QString, Task*>::iterator it = _tasks.begin();
+
+	while (it != _tasks.end()) {
+		Task *task = it.value();
+
+		if (pool->tryTake(task))
+			take(it);
+		else
+			++it;
+	}
+
+	if (wait) {
+		_lock.lock();
+		while (_running)
+			_cond.wait(&_lock);
+		_lock.unlock();
+	}
+}
@@ -0,0 +1,109 @@
+#ifndef TILESCHEDULER_H
+#define TILESCHEDULER_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QPixmap>
+#include <QRect>
+
+/* Asynchronous tile renderer shared by the vector maps and the raster maps
+   decoding their tiles. The tiles are rendered in the global thread pool, the
+   tiles closest to the viewport center first. Tiles that are already
+   queued/rendering are not scheduled again and queued tiles that are no more
+   visible can be canceled.
+
+   Prefetched tiles are rendered with the lowest priority, i.e. only by
+   otherwise idle threads, and their completion is not signaled unless they
+   have been requested by render() in the meantime. */
+class TileScheduler : public QObject
+{
+	Q_OBJECT
+
+public:
+	TileScheduler(QObject *parent = 0) : QObject(parent), _running(0) {}
+	~TileScheduler();
+
+	template<class T>
+	void render(const T &tile, const QString &key, const QRect &rect,
+	  const QPointF &center)
+	{
+		if (!promote(key, center))
+			schedule(new RenderTask<T>(tile), key, rect, center, false);
+	}
+	template<class T>
+	void prefetch(const T &tile, const QString &key, const QRect &rect)
+	{
+		if (!_tasks.contains(key))
+			schedule(new RenderTask<T>(tile), key, rect, QPointF(), true);
+	}
+
+	/* Makes a pending (prefetched) tile signal its completion, returns false
+	   when the tile is not pending */
+	bool promote(const QString &key, const QPointF &center);
+	bool isRunning(const QString &key) const;
+	bool isPending(const QString &key) const {return _tasks.contains(key);}
+	void cancel(const QRectF &rect);
+	void cancel(bool wait);
+	void cancelPrefetch();
+
+signals:
+	void finished();
+
+private slots:
+	void taskFinished(const QString &key);
+
+private:
+	class Task : public QRunnable
+	{
+	public:
+		Task() : _scheduler(0), _prefetch(false) {setAutoDelete(false);}
+		virtual ~Task() {}
+
+		virtual QPixmap pixmap() const = 0;
+		virtual bool isValid() const = 0;
+
+		void run();
+
+	protected:
+		virtual void render() = 0;
+
+	private:
+		friend class TileScheduler;
+
+		TileScheduler *_scheduler;
+		QString _key;
+		QRect _rect;
+		bool _prefetch;
+	};
+
+	template<class T>
+	class RenderTask : public Task
+	{
+	public:
+		RenderTask(const T &tile) : _tile(tile) {}
+
+		QPixmap pixmap() const {return _tile.pixmap();}
+		bool isValid() const {return _tile.isValid();}
+
+	protected:
+		void render() {_tile.render();}
+
+	private:
+		T _tile;
+	};
+
+	void schedule(Task *task, const QString &key, const QRect &rect,
+	  const QPointF &center, bool prefetch);
+	void take(QHash<QString, Task*>::iterator &it);
+	void done(Task *task);
+
+	QHash<QString, Task*> _tasks;
+	QMutex _lock;
+	QWaitCondition _cond;
+	int _running;
+};
+
+#endif // TILESCHEDULER_H
@@ -112,8 +112,8 @@ void WorldFileMap::load(const Projection &in, const Projection &out,
 
 	Q_ASSERT(!_img);
 	_img = new Image(_imgFile);
-	if (_img)
-		_img->setDevicePixelRatio(_mapRatio);
+	_img->setDevicePixelRatio(_mapRatio);
+	connect(_img, &Image::tilesLoaded, this, &WorldFileMap::tilesLoaded);
 }
 
 void WorldFileMap::unload()